@@ -1,3 +1,5 @@
+import csv
+import io
 import subprocess
 
 path = ['/home/hossein/CharRecognition/image-reterieval/test_images/1/(0,1).png',
@@ -73,32 +75,21 @@ path = ['/home/hossein/CharRecognition/image-reterieval/test_images/1/(0,1).png'
 		'/home/hossein/CharRecognition/image-reterieval/test_images/6/(6,5).png', 
 		'/home/hossein/CharRecognition/image-reterieval/test_images/6/(6,6).png']
 
-results = []
-
-for p in path:
-	
-	# Define the command and its arguments as a list
-	command = ["/home/hossein/CharRecognition/image-reterieval/src/build_cpu/recognize", p]
-
-	# Execute the command
-	result = subprocess.run(command, capture_output=True, text=True)
+# One recognize_batch process loads the templates once and recognizes every
+# image (top 5 matches each) instead of launching recognize per image
+command = ["/home/hossein/CharRecognition/image-reterieval/src/build_cpu/recognize_batch",
+           "--top-k", "5", "--format", "csv"] + path
+result = subprocess.run(command, capture_output=True, text=True)
 
-	# Print the output (stdout)
-	#print(result.stdout)
-	
-	output = result.stdout
-
-	# Find the starting index of the clause
-	start_index = output.find('Min distance:')
-
-	# If clause is found, extract everything after it
-	if start_index != -1:
-		print(p)
-		extracted_text = output[start_index + len('Min distance:'):].strip()
-		print(extracted_text)
-		
-		aa = p + '\n' + extracted_text + '\n\n\n'
-		results.append(aa)
+results = []
+for row in csv.DictReader(io.StringIO(result.stdout)):
+	if row['status'] != 'ok':
+		continue
+	matches = '\n'.join('  %s (rotation: %s°): %s' % tuple(m.split(':')) for m in row['top_k'].split(';'))
+	extracted_text = row['distance'] + '\nBest match: ' + row['letter'] + ' (rotation: ' + row['rotation'] + '°)\n' + matches
+	print(row['path'])
+	print(extracted_text)
+	results.append(row['path'] + '\n' + extracted_text + '\n\n\n')
 
 file1 = open('res.txt', 'w')
 file1.writelines(results)
@@ -0,0 +1,332 @@
+#include "parallel_recognition.h"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+
+// Micro-benchmarks for every stage of the recognizer (Google Benchmark):
+// each Hamming kernel, resize, adaptive_binarize, center_and_pack, the
+// template loaders and end-to-end recognition, over synthetic banks of
+// 100 to 100k templates and at several thread counts.
+//
+// Diffable JSON between commits:
+//   ./bench_recognition --benchmark_out=bench.json --benchmark_out_format=json
+// and compare two runs with compare.py from the Google Benchmark tools.
+
+static std::mt19937 rng(21);
+
+// n random templates cycling through 26 letters x 4 rotations; built once
+// per size and kept for the rest of the run
+static const std::vector<Template>& synthetic_templates(size_t n) {
+    static std::map<size_t, std::vector<Template>> cache;
+    std::vector<Template>& list = cache[n];
+    if (list.empty()) {
+        list.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            list[i].letter = static_cast<char>('A' + (i / 4) % 26);
+            list[i].rotation = static_cast<int>(i % 4) * 90;
+            list[i].bits.resize(TEMPLATE_BYTES);
+            for (auto& byte : list[i].bits) byte = static_cast<uint8_t>(rng() & rng());
+        }
+    }
+    return list;
+}
+
+static const TemplateBank& synthetic_bank(size_t n) {
+    static std::map<size_t, std::unique_ptr<TemplateBank>> cache;
+    std::unique_ptr<TemplateBank>& bank = cache[n];
+    if (!bank) bank = std::make_unique<TemplateBank>(synthetic_templates(n));
+    return *bank;
+}
+
+// Dark rectangles of random size on a light background, like a board cell
+static const std::vector<cv::Mat>& synthetic_glyphs() {
+    static std::vector<cv::Mat> glyphs;
+    if (glyphs.empty()) {
+        for (int i = 0; i < 256; i++) {
+            cv::Mat glyph(80, 80, CV_8UC3, cv::Scalar(255, 255, 255));
+            int x0 = 10 + rng() % 20, y0 = 10 + rng() % 20;
+            int x1 = x0 + 10 + rng() % 30, y1 = y0 + 10 + rng() % 30;
+            for (int y = y0; y < y1; y++) {
+                uint8_t* row = glyph.ptr<uint8_t>(y);
+                for (int x = x0; x < x1; x++) {
+                    row[x * 3] = row[x * 3 + 1] = row[x * 3 + 2] = 0;
+                }
+            }
+            glyphs.push_back(glyph);
+        }
+    }
+    return glyphs;
+}
+
+static std::vector<uint8_t> random_bits(size_t count) {
+    std::vector<uint8_t> bits(count * TEMPLATE_BYTES);
+    for (auto& byte : bits) byte = static_cast<uint8_t>(rng() & rng());
+    return bits;
+}
+
+// ---- Hamming kernels -------------------------------------------------------
+
+static void register_hamming_benchmarks() {
+    for (const HammingKernel& kernel : available_hamming_kernels()) {
+        std::string prefix = std::string("hamming/") + kernel.name;
+        benchmark::RegisterBenchmark((prefix + "/distance").c_str(), [kernel](benchmark::State& state) {
+            std::vector<uint8_t> bits = random_bits(2);
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(kernel.distance(bits.data(), bits.data() + TEMPLATE_BYTES));
+                benchmark::ClobberMemory();
+            }
+            state.SetBytesProcessed(state.iterations() * 2 * TEMPLATE_BYTES);
+        });
+        // Random pairs sit near distance 1500, so a bound of 200 stops early
+        benchmark::RegisterBenchmark((prefix + "/distance_bounded").c_str(), [kernel](benchmark::State& state) {
+            std::vector<uint8_t> bits = random_bits(2);
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(kernel.distance_bounded(bits.data(), bits.data() + TEMPLATE_BYTES, 200));
+                benchmark::ClobberMemory();
+            }
+        });
+        benchmark::RegisterBenchmark((prefix + "/distances_1xN").c_str(), [kernel](benchmark::State& state) {
+            const TemplateBank& bank = synthetic_bank(state.range(0));
+            std::vector<uint8_t> query = random_bits(1);
+            std::vector<uint16_t> out(bank.size());
+            for (auto _ : state) {
+                kernel.distances_1xN(query.data(), bank.data(), bank.size(), out.data());
+                benchmark::ClobberMemory();
+            }
+            state.SetItemsProcessed(state.iterations() * bank.size());
+            state.SetBytesProcessed(state.iterations() * bank.size() * TEMPLATE_BYTES);
+        })->RangeMultiplier(10)->Range(100, 100000);
+    }
+}
+
+// 16 queries (one board row) against the whole bank, active kernel
+static void BM_HammingMxN(benchmark::State& state) {
+    const TemplateBank& bank = synthetic_bank(state.range(0));
+    const size_t queries = 16;
+    std::vector<uint8_t> query_bits = random_bits(queries);
+    std::vector<uint16_t> out(queries * bank.size());
+    for (auto _ : state) {
+        hamming_distances_MxN(query_bits.data(), queries, bank.data(), bank.size(), out.data(), bank.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * queries * bank.size());
+}
+BENCHMARK(BM_HammingMxN)->RangeMultiplier(10)->Range(100, 100000);
+
+// ---- Preprocessing ---------------------------------------------------------
+
+static void BM_Resize(benchmark::State& state) {
+    const std::vector<cv::Mat>& glyphs = synthetic_glyphs();
+    cv::Mat resized;
+    size_t i = 0;
+    for (auto _ : state) {
+        cv::resize(glyphs[i++ % glyphs.size()], resized, cv::Size(TEMPLATE_SIZE, TEMPLATE_SIZE));
+        benchmark::DoNotOptimize(resized.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Resize);
+
+static void BM_AdaptiveBinarize(benchmark::State& state) {
+    std::vector<cv::Mat> resized(synthetic_glyphs().size());
+    for (size_t i = 0; i < resized.size(); i++) {
+        cv::resize(synthetic_glyphs()[i], resized[i], cv::Size(TEMPLATE_SIZE, TEMPLATE_SIZE));
+    }
+    cv::Mat binary;
+    size_t i = 0;
+    for (auto _ : state) {
+        adaptive_binarize(resized[i++ % resized.size()], binary);
+        benchmark::DoNotOptimize(binary.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AdaptiveBinarize);
+
+static std::vector<cv::Mat> binary_glyphs() {
+    std::vector<cv::Mat> binary(synthetic_glyphs().size());
+    cv::Mat resized;
+    for (size_t i = 0; i < binary.size(); i++) {
+        cv::resize(synthetic_glyphs()[i], resized, cv::Size(TEMPLATE_SIZE, TEMPLATE_SIZE));
+        adaptive_binarize(resized, binary[i]);
+    }
+    return binary;
+}
+
+static void BM_CenterAndPack(benchmark::State& state) {
+    std::vector<cv::Mat> binary = binary_glyphs();
+    std::vector<uint8_t> packed;
+    size_t i = 0;
+    for (auto _ : state) {
+        center_and_pack(binary[i++ % binary.size()], packed);
+        benchmark::DoNotOptimize(packed.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CenterAndPack);
+
+static void BM_CenterAndPackReference(benchmark::State& state) {
+    std::vector<cv::Mat> binary = binary_glyphs();
+    std::vector<uint8_t> packed;
+    size_t i = 0;
+    for (auto _ : state) {
+        center_and_pack_reference(binary[i++ % binary.size()], packed);
+        benchmark::DoNotOptimize(packed.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CenterAndPackReference);
+
+// Resize + binarize + pack, fused and as the three separate calls
+static void BM_PreprocessGlyph(benchmark::State& state) {
+    const std::vector<cv::Mat>& glyphs = synthetic_glyphs();
+    GlyphScratch scratch;
+    alignas(64) uint8_t query[TEMPLATE_BYTES];
+    size_t i = 0;
+    for (auto _ : state) {
+        if (state.range(0)) {
+            preprocess_glyph(glyphs[i++ % glyphs.size()], scratch, query);
+        } else {
+            preprocess_glyph_reference(glyphs[i++ % glyphs.size()], scratch, query);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(0) ? "fused" : "reference");
+}
+BENCHMARK(BM_PreprocessGlyph)->Arg(0)->Arg(1);
+
+// ---- Template loaders ------------------------------------------------------
+
+// The bank of the given size written once per format to the temp directory
+static std::string template_file_name(size_t n, const std::string& format) {
+    return (std::filesystem::temp_directory_path() /
+            ("bench_templates_" + std::to_string(n) + "." + format)).string();
+}
+
+static std::string template_file(size_t n, const std::string& format) {
+    std::string path = template_file_name(n, format);
+    static std::map<std::string, bool> written;
+    if (written[path]) return path;
+    const std::vector<Template>& list = synthetic_templates(n);
+    if (format == "txt") {
+        save_templates_text(path, list);
+    } else if (format == "bank") {
+        synthetic_bank(n).save(path);
+    } else {
+        // Legacy records: letter (1 byte), rotation (int), 512 bytes of bits
+        std::ofstream out(path, std::ios::binary);
+        for (const Template& t : list) {
+            out.write(&t.letter, 1);
+            out.write(reinterpret_cast<const char*>(&t.rotation), sizeof(int));
+            out.write(reinterpret_cast<const char*>(t.bits.data()), TEMPLATE_BYTES);
+        }
+    }
+    written[path] = true;
+    return path;
+}
+
+// What load_templates does, minus the console output
+static void BM_LoadTemplatesText(benchmark::State& state) {
+    std::string path = template_file(state.range(0), "txt");
+    for (auto _ : state) {
+        TemplateBank bank(read_templates_text(path));
+        benchmark::DoNotOptimize(bank.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadTemplatesText)->Unit(benchmark::kMillisecond)->RangeMultiplier(10)->Range(100, 10000);
+
+// What load_templates_binary does for a legacy record file
+static void BM_LoadTemplatesBinaryLegacy(benchmark::State& state) {
+    std::string path = template_file(state.range(0), "bin");
+    for (auto _ : state) {
+        TemplateBank bank(read_templates_binary(path));
+        benchmark::DoNotOptimize(bank.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadTemplatesBinaryLegacy)->Unit(benchmark::kMillisecond)->RangeMultiplier(10)->Range(100, 100000);
+
+// What load_templates_binary does for a versioned bank file
+static void BM_LoadTemplatesBinaryMapped(benchmark::State& state) {
+    std::string path = template_file(state.range(0), "bank");
+    for (auto _ : state) {
+        TemplateBank bank = TemplateBank::open_mapped(path);
+        benchmark::DoNotOptimize(bank.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadTemplatesBinaryMapped)->Unit(benchmark::kMillisecond)->RangeMultiplier(10)->Range(100, 100000);
+
+// ---- End to end ------------------------------------------------------------
+
+// The free functions match against the global bank; switched once per
+// size, before any benchmark thread starts
+static void use_global_bank(const benchmark::State& state) {
+    templates = synthetic_templates(state.range(0));
+    rebuild_template_bank();
+    synthetic_glyphs();
+}
+
+static void BM_RecognizeLetterWithRotation(benchmark::State& state) {
+    const std::vector<cv::Mat>& glyphs = synthetic_glyphs();
+    size_t i = state.thread_index();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(recognize_letter_with_rotation(glyphs[i++ % glyphs.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecognizeLetterWithRotation)->Setup(use_global_bank)->RangeMultiplier(10)->Range(100, 100000)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))->UseRealTime();
+
+// Matching a packed query only (no preprocessing)
+static void BM_RecognizerMatch(benchmark::State& state) {
+    Recognizer recognizer(synthetic_templates(state.range(0)));
+    std::vector<uint8_t> queries = random_bits(64);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(recognizer.match(queries.data() + (i++ % 64) * TEMPLATE_BYTES));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecognizerMatch)->RangeMultiplier(10)->Range(100, 100000);
+
+// A batch of glyphs on the work-stealing pool: args are bank size, threads
+static void BM_RecognizeGlyphsParallel(benchmark::State& state) {
+    Recognizer recognizer(synthetic_templates(state.range(0)));
+    ThreadPool pool(state.range(1));
+    const std::vector<cv::Mat>& glyphs = synthetic_glyphs();
+    recognize_glyphs_parallel(pool, recognizer, glyphs);  // Warm-up (scratch, caches)
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(recognize_glyphs_parallel(pool, recognizer, glyphs));
+    }
+    state.SetItemsProcessed(state.iterations() * glyphs.size());
+}
+
+static void parallel_arguments(benchmark::internal::Benchmark* b) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int bank : {1000, 10000, 100000}) {
+        for (int threads = 1; threads < max_threads; threads *= 2) b->Args({bank, threads});
+        b->Args({bank, max_threads});
+    }
+}
+BENCHMARK(BM_RecognizeGlyphsParallel)->Apply(parallel_arguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::AddCustomContext("hamming_kernel", active_hamming_kernel().name);
+    register_hamming_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    for (size_t n : {100, 1000, 10000, 100000}) {
+        for (const char* format : {"txt", "bin", "bank"}) {
+            std::remove(template_file_name(n, format).c_str());
+        }
+    }
+    return 0;
+}
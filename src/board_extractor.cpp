@@ -0,0 +1,121 @@
+#include "board_extractor.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// Splits one CSV line; a quoted field may contain commas ("(1,1)")
+static std::vector<std::string> split_csv_line(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+static std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return std::string();
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+BoardExtractor::BoardExtractor(const std::string& coords_csv, bool rotate_180) {
+    std::ifstream file(coords_csv);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open coordinates file: " + coords_csv);
+    }
+
+    // Destination corners in CSV order: top-left, bottom-left, bottom-right,
+    // top-right. Turning the output by 180 degrees swaps opposite corners.
+    const float last = CELL_SIZE - 1;
+    cv::Point2f dst[4] = {{0, 0}, {0, last}, {last, last}, {last, 0}};
+    if (rotate_180) {
+        std::swap(dst[0], dst[2]);
+        std::swap(dst[1], dst[3]);
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        std::vector<std::string> fields = split_csv_line(line);
+        if (fields.size() == 1 && trim(fields[0]).empty()) continue;
+        if (line_number == 1 && trim(fields[0]) == "place") continue;  // Header
+
+        if (fields.size() != 9) {
+            std::cerr << "Warning: Skipping line " << line_number << " of " << coords_csv
+                      << " (expected 9 fields, got " << fields.size() << ")" << std::endl;
+            continue;
+        }
+
+        cv::Point2f src[4];
+        bool valid = true;
+        for (int k = 0; k < 8 && valid; k++) {
+            std::istringstream value(fields[1 + k]);
+            float v;
+            if (!(value >> v)) {
+                valid = false;
+                break;
+            }
+            if (k % 2 == 0) src[k / 2].x = v; else src[k / 2].y = v;
+        }
+        if (!valid) {
+            std::cerr << "Warning: Skipping line " << line_number << " of " << coords_csv
+                      << " (invalid coordinate)" << std::endl;
+            continue;
+        }
+
+        // Python wrote the names with spaces and underscores stripped
+        std::string place;
+        for (char c : trim(fields[0])) {
+            if (c != ' ' && c != '_') place += c;
+        }
+        places_.push_back(place);
+        homographies_.push_back(cv::getPerspectiveTransform(src, dst));
+    }
+
+    if (places_.empty()) {
+        throw std::runtime_error("No cell quads found in " + coords_csv);
+    }
+}
+
+int BoardExtractor::index_of(const std::string& place) const {
+    for (size_t i = 0; i < places_.size(); i++) {
+        if (places_[i] == place) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void BoardExtractor::extract_cell(const cv::Mat& capture, size_t i, cv::Mat& cell) const {
+    cv::warpPerspective(capture, cell, homographies_[i], cv::Size(CELL_SIZE, CELL_SIZE));
+}
+
+void BoardExtractor::extract(const cv::Mat& capture, std::vector<cv::Mat>& cells) const {
+    cells.resize(places_.size());
+    // Allocate up front so the parallel loop only writes into its own cell
+    for (cv::Mat& cell : cells) {
+        cell.create(CELL_SIZE, CELL_SIZE, capture.type());
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < static_cast<int>(places_.size()); i++) {
+        extract_cell(capture, i, cells[i]);
+    }
+}
+
+std::vector<cv::Mat> BoardExtractor::extract(const cv::Mat& capture) const {
+    std::vector<cv::Mat> cells;
+    extract(capture, cells);
+    return cells;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "letter_recognition.h"
+#include <string>
+#include <vector>
+
+// Grid cells of one board capture, warped straight into TEMPLATE_SIZE x
+// TEMPLATE_SIZE images (the C++ counterpart of image_corpper.py).
+//
+// The quad layout comes from coords.csv (place,x1,y1,x2,y2,x3,y3,x4,y4 with
+// corners top-left, bottom-left, bottom-right, top-right) and is loaded once;
+// every homography is computed up front. The optional 180 degree turn is
+// folded into the destination corners, so each cell costs one warp.
+class BoardExtractor {
+public:
+    static constexpr int CELL_SIZE = TEMPLATE_SIZE;
+
+    BoardExtractor() = default;
+    // Throws std::runtime_error if the file cannot be opened or holds no quads
+    explicit BoardExtractor(const std::string& coords_csv, bool rotate_180 = true);
+
+    size_t size() const { return places_.size(); }
+    bool empty() const { return places_.empty(); }
+    // Place name as written in the CSV, e.g. "(1,1)"
+    const std::string& place(size_t i) const { return places_[i]; }
+    // Index of a place, or -1 if it is not in the layout
+    int index_of(const std::string& place) const;
+
+    // Warps every cell of a BGR (or gray) capture; cells[i] is CELL_SIZE x
+    // CELL_SIZE with the capture's type. Cells are processed in parallel and
+    // existing buffers in `cells` are reused.
+    void extract(const cv::Mat& capture, std::vector<cv::Mat>& cells) const;
+    std::vector<cv::Mat> extract(const cv::Mat& capture) const;
+    // A single cell
+    void extract_cell(const cv::Mat& capture, size_t i, cv::Mat& cell) const;
+
+private:
+    std::vector<std::string> places_;
+    std::vector<cv::Mat> homographies_;  // 3x3 CV_64F, capture -> cell
+};
@@ -55,7 +55,7 @@ if (!$opencvFound) {
 
 # Compile template_generator
 Write-Host "Compiling template_generator..." -ForegroundColor Yellow
-$result = & g++ -std=c++17 -O3 $opencvInclude -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp $opencvLibs 2>&1
+$result = & g++ -std=c++17 -O3 $opencvInclude -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $opencvLibs 2>&1
 if ($LASTEXITCODE -ne 0) {
     Write-Host "Error compiling template_generator:" -ForegroundColor Red
     Write-Host $result -ForegroundColor Red
@@ -64,7 +64,7 @@ if ($LASTEXITCODE -ne 0) {
 
 # Compile recognize
 Write-Host "Compiling recognize..." -ForegroundColor Yellow
-$result = & g++ -std=c++17 -O3 $opencvInclude -o recognize.exe ../recognize.cpp ../letter_recognition.cpp $opencvLibs 2>&1
+$result = & g++ -std=c++17 -O3 $opencvInclude -o recognize.exe ../recognize.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $opencvLibs 2>&1
 if ($LASTEXITCODE -ne 0) {
     Write-Host "Error compiling recognize:" -ForegroundColor Red
     Write-Host $result -ForegroundColor Red
@@ -73,7 +73,7 @@ if ($LASTEXITCODE -ne 0) {
 
 # Compile main
 Write-Host "Compiling main..." -ForegroundColor Yellow
-$result = & g++ -std=c++17 -O3 $opencvInclude -o main.exe ../main.cpp ../letter_recognition.cpp $opencvLibs 2>&1
+$result = & g++ -std=c++17 -O3 $opencvInclude -o main.exe ../main.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $opencvLibs 2>&1
 if ($LASTEXITCODE -ne 0) {
     Write-Host "Error compiling main:" -ForegroundColor Red
     Write-Host $result -ForegroundColor Red
@@ -25,21 +25,21 @@ OPENCV_CFLAGS=$(pkg-config --cflags opencv4)
 OPENCV_LIBS=$(pkg-config --libs opencv4)
 
 echo "Compiling template_generator..."
-g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o template_generator ../template_generator.cpp ../letter_recognition.cpp $OPENCV_LIBS
+g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o template_generator ../template_generator.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $OPENCV_LIBS
 if [ $? -ne 0 ]; then
     echo "Error compiling template_generator"
     exit 1
 fi
 
 echo "Compiling recognize..."
-g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o recognize ../recognize.cpp ../letter_recognition.cpp $OPENCV_LIBS
+g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o recognize ../recognize.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $OPENCV_LIBS
 if [ $? -ne 0 ]; then
     echo "Error compiling recognize"
     exit 1
 fi
 
 echo "Compiling main..."
-g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o main ../main.cpp ../letter_recognition.cpp $OPENCV_LIBS
+g++ -std=c++17 -O3 -fopenmp $OPENCV_CFLAGS -o main ../main.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp $OPENCV_LIBS
 if [ $? -ne 0 ]; then
     echo "Error compiling main"
     exit 1
@@ -50,7 +50,7 @@ if %OPENCV_FOUND%==0 (
 
 REM Compile template_generator
 echo Compiling template_generator...
-g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 if %errorlevel% neq 0 (
     echo Error compiling template_generator
     exit /b 1
@@ -58,7 +58,7 @@ if %errorlevel% neq 0 (
 
 REM Compile recognize
 echo Compiling recognize...
-g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o recognize.exe ../recognize.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o recognize.exe ../recognize.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 if %errorlevel% neq 0 (
     echo Error compiling recognize
     exit /b 1
@@ -66,7 +66,7 @@ if %errorlevel% neq 0 (
 
 REM Compile main
 echo Compiling main...
-g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o main.exe ../main.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 %OPENCV_INCLUDE% -o main.exe ../main.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 if %errorlevel% neq 0 (
     echo Error compiling main
     exit /b 1
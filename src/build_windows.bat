@@ -25,19 +25,19 @@ cd build_cpu
 
 REM Compile template_generator
 echo Compiling template_generator...
-g++ -std=c++17 -O3 -fopenmp -march=native -msse4.2 -mavx2 %OPENCV_INCLUDE% -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 -fopenmp %OPENCV_INCLUDE% -o template_generator.exe ../template_generator.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 
 REM Compile recognize
 echo Compiling recognize...
-g++ -std=c++17 -O3 -fopenmp -march=native -msse4.2 -mavx2 %OPENCV_INCLUDE% -o recognize.exe ../recognize.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 -fopenmp %OPENCV_INCLUDE% -o recognize.exe ../recognize.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 
 REM Compile main
 echo Compiling main...
-g++ -std=c++17 -O3 -fopenmp -march=native -msse4.2 -mavx2 %OPENCV_INCLUDE% -o main.exe ../main.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 -fopenmp %OPENCV_INCLUDE% -o main.exe ../main.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 
 REM Compile test program
 echo Compiling test_recognition...
-g++ -std=c++17 -O3 -fopenmp -march=native -msse4.2 -mavx2 %OPENCV_INCLUDE% -o test_recognition.exe ../test_recognition.cpp ../letter_recognition.cpp %OPENCV_LIBS%
+g++ -std=c++17 -O3 -fopenmp %OPENCV_INCLUDE% -o test_recognition.exe ../test_recognition.cpp ../letter_recognition.cpp ../template_bank.cpp ../recognizer.cpp ../board_extractor.cpp ../thread_pool.cpp ../parallel_recognition.cpp ../pipeline.cpp %OPENCV_LIBS%
 
 echo Build completed!
 echo.
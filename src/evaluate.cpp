@@ -0,0 +1,357 @@
+#include "parallel_recognition.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+
+// Golden-accuracy and throughput check in one run: templates are built in
+// memory from dataset/ (same parsing and preprocessing as
+// template_generator), every labelled crop under the image directories is
+// recognized, and accuracy, a confusion matrix, a per-rotation breakdown
+// and images/s are printed. --min-accuracy turns it into a pass/fail gate.
+//
+// Labels come from a manifest (CSV: key,letter[,rotation]) whose key is the
+// image path relative to the manifest's directory without the extension,
+// e.g. "3/(2,1)", or just the (row,col) stem. Images named like dataset
+// files (<letter>_<rotation>_<n>) label themselves; anything else is
+// skipped.
+
+namespace fs = std::filesystem;
+
+struct EvalOptions {
+    std::string dataset_path = "../../dataset";
+    std::string templates_path;  // Prebuilt bank instead of the dataset
+    std::string labels_path;     // Default: <first image directory>/labels.csv
+    bool upright_only = false;
+    int threads = 0;             // 0 = all hardware threads
+    int threshold = -1;          // -1 = SAFE_THRESHOLD
+    std::string thresholds_path; // Calibration file (templates.thresholds)
+    int shift_radius = -1;       // -1 = SHIFT_RADIUS
+    size_t repeat = 3;
+    double min_accuracy = -1;    // Percent; < 0 = no gate
+    bool list_errors = false;
+    std::vector<std::string> inputs;
+};
+
+struct Label {
+    char letter;
+    int rotation;  // -1 = not given
+};
+
+struct Sample {
+    std::string path;
+    Label label;
+};
+
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [image|directory]..." << std::endl;
+    std::cerr << "  (default: ../../test_images)" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --dataset DIR      build templates from DIR (default: ../../dataset)" << std::endl;
+    std::cerr << "  --templates PATH   use a template file instead of the dataset" << std::endl;
+    std::cerr << "  --upright-only     build only the _0_ templates (query rotation)" << std::endl;
+    std::cerr << "  --labels FILE      manifest: key,letter[,rotation] per line (default: labels.csv" << std::endl;
+    std::cerr << "                     in the first image directory, if present)" << std::endl;
+    std::cerr << "  --threads N        worker threads (default: all cores)" << std::endl;
+    std::cerr << "  --threshold N      reject above this distance (default: " << SAFE_THRESHOLD << ")" << std::endl;
+    std::cerr << "  --thresholds FILE  calibrated global + per-letter thresholds" << std::endl;
+    std::cerr << "  --shift-radius N   also match at offsets of up to N pixels, 0-" << MAX_SHIFT_RADIUS << std::endl;
+    std::cerr << "  --repeat N         timed passes, best one reported (default: 3)" << std::endl;
+    std::cerr << "  --min-accuracy P   exit with status 1 if letter accuracy is below P percent" << std::endl;
+    std::cerr << "  --list-errors      print every misrecognized image" << std::endl;
+}
+
+static bool is_image_file(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp";
+}
+
+static bool parse_args(int argc, char** argv, EvalOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--dataset" && has_value) options.dataset_path = argv[++i];
+        else if (arg == "--templates" && has_value) options.templates_path = argv[++i];
+        else if (arg == "--upright-only") options.upright_only = true;
+        else if (arg == "--labels" && has_value) options.labels_path = argv[++i];
+        else if (arg == "--threads" && has_value) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--threshold" && has_value) options.threshold = std::atoi(argv[++i]);
+        else if (arg == "--thresholds" && has_value) options.thresholds_path = argv[++i];
+        else if (arg == "--shift-radius" && has_value) {
+            options.shift_radius = std::atoi(argv[++i]);
+            if (options.shift_radius < 0 || options.shift_radius > MAX_SHIFT_RADIUS) {
+                std::cerr << "Error: --shift-radius must be 0 to " << MAX_SHIFT_RADIUS << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--repeat" && has_value) options.repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--min-accuracy" && has_value) options.min_accuracy = std::atof(argv[++i]);
+        else if (arg == "--list-errors") options.list_errors = true;
+        else if (!arg.empty() && arg[0] == '-') return false;
+        else options.inputs.push_back(arg);
+    }
+    if (options.inputs.empty()) options.inputs.push_back("../../test_images");
+    return true;
+}
+
+// Manifest key of an image: its path relative to base without the extension
+static std::string manifest_key(const fs::path& path, const fs::path& base) {
+    fs::path relative = path.lexically_relative(base);
+    if (relative.empty() || *relative.begin() == "..") relative = path.filename();
+    return relative.replace_extension().generic_string();
+}
+
+// key,letter[,rotation] lines; '#' comments and a "place,..." header are skipped
+static bool read_labels(const std::string& path, std::map<std::string, Label>& labels) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open labels " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#' || line.compare(0, 6, "place,") == 0) continue;
+        // The key itself holds a comma: "(row,col)" may be quoted like coords.csv
+        std::string key;
+        size_t pos;
+        if (line[0] == '"') {
+            size_t close = line.find('"', 1);
+            if (close == std::string::npos) close = line.size();
+            key = line.substr(1, close - 1);
+            pos = line.find(',', close);
+        } else {
+            size_t paren = line.find(')');
+            pos = line.find(',', paren == std::string::npos ? 0 : paren);
+            key = line.substr(0, pos);
+        }
+        std::string letter_field, rotation_field;
+        if (pos != std::string::npos) {
+            size_t next = line.find(',', pos + 1);
+            letter_field = line.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+            if (next != std::string::npos) rotation_field = line.substr(next + 1);
+        }
+        if (key.empty() || letter_field.empty()) {
+            std::cerr << "Warning: " << path << ":" << line_number << ": expected key,letter[,rotation]" << std::endl;
+            continue;
+        }
+        Label label{letter_field[0], rotation_field.empty() ? -1 : std::atoi(rotation_field.c_str())};
+        labels[fs::path(key).replace_extension().generic_string()] = label;
+    }
+    return true;
+}
+
+// Labelled images under the inputs (directories searched recursively, sorted)
+static bool collect_samples(const EvalOptions& options, std::vector<Sample>& samples, size_t& unlabelled) {
+    std::string labels_path = options.labels_path;
+    if (labels_path.empty() && fs::is_directory(options.inputs[0]) &&
+        fs::exists(fs::path(options.inputs[0]) / "labels.csv")) {
+        labels_path = (fs::path(options.inputs[0]) / "labels.csv").string();
+    }
+    std::map<std::string, Label> labels;
+    fs::path labels_base;
+    if (!labels_path.empty()) {
+        if (!read_labels(labels_path, labels)) return false;
+        labels_base = fs::path(labels_path).parent_path();
+        std::cout << "Labels: " << labels.size() << " from " << labels_path << std::endl;
+    }
+
+    std::vector<fs::path> paths;
+    for (const std::string& input : options.inputs) {
+        if (fs::is_directory(input)) {
+            std::vector<fs::path> found;
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && is_image_file(entry.path())) found.push_back(entry.path());
+            }
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        } else {
+            paths.emplace_back(input);
+        }
+    }
+
+    unlabelled = 0;
+    for (const fs::path& path : paths) {
+        Sample sample{path.string(), {0, -1}};
+        auto it = labels.find(manifest_key(path, labels_base));
+        if (it == labels.end()) it = labels.find(path.stem().string());
+        if (it != labels.end()) {
+            sample.label = it->second;
+        } else if (!parse_template_filename(path.stem().string(), sample.label.letter, sample.label.rotation)) {
+            unlabelled++;
+            continue;
+        }
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+// Rows: label, columns: recognized. With many classes only the rows that
+// hold an error (and the columns they use) are printed.
+static void print_confusion_matrix(const std::map<std::pair<char, char>, size_t>& confusion) {
+    std::set<char> labels, wrong;
+    for (const auto& cell : confusion) {
+        labels.insert(cell.first.first);
+        if (cell.first.first != cell.first.second) wrong.insert(cell.first.first);
+    }
+    bool errors_only = labels.size() > 20;
+    if (errors_only && wrong.empty()) {
+        std::cout << "Confusion matrix: no confusions" << std::endl;
+        return;
+    }
+    const std::set<char>& truths = errors_only ? wrong : labels;
+    std::set<char> predictions;
+    for (const auto& cell : confusion) {
+        if (truths.count(cell.first.first)) predictions.insert(cell.first.second);
+    }
+    std::cout << "Confusion matrix (rows: label, columns: recognized"
+              << (errors_only ? "; labels with errors only" : "") << "):" << std::endl;
+    std::cout << "     ";
+    for (char p : predictions) std::cout << std::setw(4) << p;
+    std::cout << std::endl;
+    for (char t : truths) {
+        std::cout << std::setw(4) << t << " ";
+        for (char p : predictions) {
+            auto it = confusion.find({t, p});
+            if (it == confusion.end()) {
+                std::cout << std::setw(4) << ".";
+            } else {
+                std::cout << std::setw(4) << it->second;
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+static double percent(size_t part, size_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+int main(int argc, char** argv) {
+    EvalOptions options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    RecognizerConfig config;
+    config.threshold = options.threshold >= 0 ? options.threshold : SAFE_THRESHOLD;
+    config.shift_radius = options.shift_radius >= 0 ? options.shift_radius : SHIFT_RADIUS;
+    Recognizer recognizer;
+    try {
+        if (!options.thresholds_path.empty()) {
+            use_threshold_calibration(config, load_threshold_calibration(options.thresholds_path));
+        }
+        if (!options.templates_path.empty()) {
+            recognizer = Recognizer::from_file(options.templates_path, config);
+            std::cout << "Templates: " << recognizer.bank().size() << " from " << options.templates_path << std::endl;
+        } else {
+            recognizer = Recognizer(read_templates_dataset(options.dataset_path, options.upright_only), config);
+            std::cout << "Templates: " << recognizer.bank().size() << " built from " << options.dataset_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading templates: " << e.what() << std::endl;
+        return 1;
+    }
+    if (recognizer.bank().empty()) {
+        std::cerr << "Error: No templates" << std::endl;
+        return 1;
+    }
+
+    std::vector<Sample> samples;
+    size_t unlabelled = 0;
+    if (!collect_samples(options, samples, unlabelled)) return 1;
+
+    // Decode up front so the timed passes measure recognition only
+    std::vector<cv::Mat> images;
+    std::vector<Sample> decoded;
+    for (const Sample& sample : samples) {
+        cv::Mat image = cv::imread(sample.path);
+        if (image.empty()) {
+            std::cerr << "Warning: Could not read " << sample.path << std::endl;
+            continue;
+        }
+        images.push_back(image);
+        decoded.push_back(sample);
+    }
+    std::cout << "Images: " << decoded.size() << " labelled";
+    if (unlabelled) std::cout << ", " << unlabelled << " without a label skipped";
+    std::cout << std::endl;
+    if (images.empty()) {
+        std::cerr << "Error: No labelled images (see --labels)" << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool(options.threads > 0 ? options.threads : 0);
+    std::vector<RecognitionResult> results = recognize_glyphs_parallel(pool, recognizer, images);  // Warm-up
+    double best_seconds = 0;
+    for (size_t pass = 0; pass < options.repeat; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        results = recognize_glyphs_parallel(pool, recognizer, images);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || seconds < best_seconds) best_seconds = seconds;
+    }
+
+    size_t letter_correct = 0, rotation_known = 0, rotation_correct = 0, rejected = 0;
+    std::map<std::pair<char, char>, size_t> confusion;
+    struct RotationStats { size_t count = 0, letter = 0, both = 0; };
+    std::map<int, RotationStats> by_rotation;
+    for (size_t i = 0; i < decoded.size(); i++) {
+        const Label& label = decoded[i].label;
+        const RecognitionResult& result = results[i];
+        bool letter_ok = result.letter == label.letter;
+        bool rotation_ok = letter_ok && result.rotation == label.rotation;
+        if (result.letter == '?') rejected++;
+        if (letter_ok) letter_correct++;
+        confusion[{label.letter, result.letter}]++;
+        if (label.rotation >= 0) {
+            rotation_known++;
+            if (rotation_ok) rotation_correct++;
+            RotationStats& stats = by_rotation[label.rotation];
+            stats.count++;
+            if (letter_ok) stats.letter++;
+            if (rotation_ok) stats.both++;
+        }
+        if (options.list_errors && !(letter_ok && (label.rotation < 0 || rotation_ok))) {
+            std::cout << "  " << decoded[i].path << ": expected " << label.letter;
+            if (label.rotation >= 0) std::cout << " " << label.rotation << "°";
+            std::cout << ", got " << result.letter << " " << result.rotation << "° (distance "
+                      << result.confidence << ")" << std::endl;
+        }
+    }
+
+    double accuracy = percent(letter_correct, decoded.size());
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Letter accuracy: " << letter_correct << "/" << decoded.size() << " (" << accuracy << "%), "
+              << rejected << " rejected" << std::endl;
+    if (rotation_known) {
+        std::cout << "Letter + rotation: " << rotation_correct << "/" << rotation_known << " ("
+                  << percent(rotation_correct, rotation_known) << "%)" << std::endl;
+        std::cout << "Per rotation:" << std::endl;
+        for (const auto& entry : by_rotation) {
+            std::cout << "  " << std::setw(3) << entry.first << "°: " << entry.second.count << " images, letter "
+                      << percent(entry.second.letter, entry.second.count) << "%, letter + rotation "
+                      << percent(entry.second.both, entry.second.count) << "%" << std::endl;
+        }
+    }
+    print_confusion_matrix(confusion);
+    std::cout << "Throughput: " << std::setprecision(0) << images.size() / best_seconds << " images/s on "
+              << pool.size() << " threads (preprocess + match, decode excluded, best of " << options.repeat
+              << ")" << std::endl;
+
+    if (options.min_accuracy >= 0 && accuracy < options.min_accuracy) {
+        std::cerr << std::fixed << std::setprecision(1) << "FAIL: letter accuracy " << accuracy << "% is below "
+                  << options.min_accuracy << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
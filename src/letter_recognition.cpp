@@ -1,67 +1,494 @@
 #include "letter_recognition.h"
+#include "template_bank.h"
+#include "recognizer.h"
+#include "trace.h"
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <omp.h>
 #include <map>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <filesystem>
+#include <sstream>
 
 // Platform-specific includes
 #if defined(__arm__) || defined(__aarch64__)
-    #include <arm_neon.h>
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+    #if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+    #endif
 #elif defined(__x86_64__)
     #include <immintrin.h>
-    #include <emmintrin.h>
 #endif
 
 std::vector<Template> templates;
 int SAFE_THRESHOLD = 200;  // Adjusted for 64x64 templates (512 bytes vs 8192 bytes)
+bool EARLY_EXIT_AT_THRESHOLD = false;
+size_t COARSE_TO_FINE_MIN_TEMPLATES = 4096;
+int SHIFT_RADIUS = 0;
+std::shared_ptr<const LetterThresholds> LETTER_THRESHOLDS;
+size_t CLASS_INDEX_MIN_CLASS_SIZE = 4;
 
 // Removed gpu_warp function as coordinates are no longer needed
 
+// Hamming distance kernels over 512-byte (64x64) bitplanes.
+// Every kernel accumulates into lanes of 16 bits or wider so the count
+// can never wrap (the maximum distance is 4096). The best kernel for the
+// running CPU is chosen once at startup, so one binary serves every host.
+// The 1xN variants load the query once and stream a contiguous
+// TEMPLATE_BYTES-stride template matrix past it. The bounded variants stop
+// after the first 64-byte chunk that pushes the count past `bound` and
+// return that partial (> bound) count.
+
+static uint16_t hamming_distance_scalar(const uint8_t* a, const uint8_t* b) {
+    uint32_t result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        result += __builtin_popcountll(va ^ vb);
+    }
+    return static_cast<uint16_t>(result);
+}
+
+static uint16_t hamming_bounded_scalar(const uint8_t* a, const uint8_t* b, int bound) {
+    int result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        for(int j=i; j<i+64; j+=8) {
+            uint64_t va, vb;
+            std::memcpy(&va, a + j, 8);
+            std::memcpy(&vb, b + j, 8);
+            result += __builtin_popcountll(va ^ vb);
+        }
+        if(result > bound) break;
+    }
+    return static_cast<uint16_t>(result);
+}
+
+static void hamming_1xN_scalar(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out) {
+    uint64_t q[TEMPLATE_BYTES / 8];
+    std::memcpy(q, query, TEMPLATE_BYTES);
+    for(size_t t=0; t<count; t++) {
+        const uint8_t* row = bank + t * TEMPLATE_BYTES;
+        uint32_t result = 0;
+        for(int i=0; i<TEMPLATE_BYTES / 8; i++) {
+            uint64_t v;
+            std::memcpy(&v, row + i * 8, 8);
+            result += __builtin_popcountll(q[i] ^ v);
+        }
+        out[t] = static_cast<uint16_t>(result);
+    }
+}
+
+#if defined(__x86_64__)
+// Same loop, but compiled so __builtin_popcountll becomes a single popcnt
+__attribute__((target("popcnt")))
+static uint16_t hamming_distance_popcnt(const uint8_t* a, const uint8_t* b) {
+    uint64_t result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        result += __builtin_popcountll(va ^ vb);
+    }
+    return static_cast<uint16_t>(result);
+}
+
+__attribute__((target("popcnt")))
+static uint16_t hamming_bounded_popcnt(const uint8_t* a, const uint8_t* b, int bound) {
+    int result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        for(int j=i; j<i+64; j+=8) {
+            uint64_t va, vb;
+            std::memcpy(&va, a + j, 8);
+            std::memcpy(&vb, b + j, 8);
+            result += __builtin_popcountll(va ^ vb);
+        }
+        if(result > bound) break;
+    }
+    return static_cast<uint16_t>(result);
+}
+
+__attribute__((target("popcnt")))
+static void hamming_1xN_popcnt(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out) {
+    uint64_t q[TEMPLATE_BYTES / 8];
+    std::memcpy(q, query, TEMPLATE_BYTES);
+    for(size_t t=0; t<count; t++) {
+        const uint8_t* row = bank + t * TEMPLATE_BYTES;
+        uint64_t result = 0;
+        for(int i=0; i<TEMPLATE_BYTES / 8; i++) {
+            uint64_t v;
+            std::memcpy(&v, row + i * 8, 8);
+            result += __builtin_popcountll(q[i] ^ v);
+        }
+        out[t] = static_cast<uint16_t>(result);
+    }
+}
+
+// Nibble lookup popcount (vpshufb): per-byte bit counts of x
+__attribute__((target("avx2")))
+static inline __m256i popcount_epi8_avx2(__m256i x) {
+    const __m256i lut = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                         0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    return _mm256_add_epi8(
+        _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low_mask)),
+        _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask)));
+}
+
+__attribute__((target("avx2")))
+static inline uint16_t reduce_epi64_avx2(__m256i sum) {
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    return static_cast<uint16_t>(_mm_cvtsi128_si64(s));
+}
+
+// Byte counts reduced with vpsadbw into 64-bit lanes
+__attribute__((target("avx2")))
+static uint16_t hamming_distance_avx2(const uint8_t* a, const uint8_t* b) {
+    __m256i sum = _mm256_setzero_si256();
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i + 32)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i + 32)));
+        // At most 16 per byte lane here, then widened before it can wrap
+        __m256i c = _mm256_add_epi8(popcount_epi8_avx2(x0), popcount_epi8_avx2(x1));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+    }
+    return reduce_epi64_avx2(sum);
+}
+
+__attribute__((target("avx2")))
+static uint16_t hamming_bounded_avx2(const uint8_t* a, const uint8_t* b, int bound) {
+    int result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i + 32)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i + 32)));
+        __m256i c = _mm256_add_epi8(popcount_epi8_avx2(x0), popcount_epi8_avx2(x1));
+        result += reduce_epi64_avx2(_mm256_sad_epu8(c, _mm256_setzero_si256()));
+        if(result > bound) break;
+    }
+    return static_cast<uint16_t>(result);
+}
+
+__attribute__((target("avx2")))
+static void hamming_1xN_avx2(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out) {
+    __m256i q[TEMPLATE_BYTES / 32];
+    for(int j=0; j<TEMPLATE_BYTES / 32; j++) {
+        q[j] = _mm256_loadu_si256((const __m256i*)(query + j * 32));
+    }
+    for(size_t t=0; t<count; t++) {
+        const uint8_t* row = bank + t * TEMPLATE_BYTES;
+        __m256i sum = _mm256_setzero_si256();
+        for(int j=0; j<TEMPLATE_BYTES / 32; j+=2) {
+            __m256i x0 = _mm256_xor_si256(q[j], _mm256_loadu_si256((const __m256i*)(row + j * 32)));
+            __m256i x1 = _mm256_xor_si256(q[j + 1], _mm256_loadu_si256((const __m256i*)(row + j * 32 + 32)));
+            __m256i c = _mm256_add_epi8(popcount_epi8_avx2(x0), popcount_epi8_avx2(x1));
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+        }
+        out[t] = reduce_epi64_avx2(sum);
+    }
+}
+
+// Native 64-bit lane popcount (vpopcntq)
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint16_t hamming_distance_avx512(const uint8_t* a, const uint8_t* b) {
+    __m512i sum = _mm512_setzero_si512();
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void*)(a + i)),
+                                     _mm512_loadu_si512((const void*)(b + i)));
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+    }
+    return static_cast<uint16_t>(_mm512_reduce_add_epi64(sum));
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint16_t hamming_bounded_avx512(const uint8_t* a, const uint8_t* b, int bound) {
+    int result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void*)(a + i)),
+                                     _mm512_loadu_si512((const void*)(b + i)));
+        result += static_cast<int>(_mm512_reduce_add_epi64(_mm512_popcnt_epi64(x)));
+        if(result > bound) break;
+    }
+    return static_cast<uint16_t>(result);
+}
+
+// The whole query fits in 8 zmm registers
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void hamming_1xN_avx512(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out) {
+    __m512i q[TEMPLATE_BYTES / 64];
+    for(int j=0; j<TEMPLATE_BYTES / 64; j++) {
+        q[j] = _mm512_loadu_si512((const void*)(query + j * 64));
+    }
+    for(size_t t=0; t<count; t++) {
+        const uint8_t* row = bank + t * TEMPLATE_BYTES;
+        __m512i sum = _mm512_setzero_si512();
+        for(int j=0; j<TEMPLATE_BYTES / 64; j++) {
+            __m512i x = _mm512_xor_si512(q[j], _mm512_loadu_si512((const void*)(row + j * 64)));
+            sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+        }
+        out[t] = static_cast<uint16_t>(_mm512_reduce_add_epi64(sum));
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+// vcnt per byte, then vpadal pairwise-widens into 16-bit lanes
+static uint16_t hamming_distance_neon(const uint8_t* a, const uint8_t* b) {
+    uint16x8_t sum = vdupq_n_u16(0);
+    for(int i=0; i<TEMPLATE_BYTES; i+=32) {
+        uint8x16_t c0 = vcntq_u8(veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        uint8x16_t c1 = vcntq_u8(veorq_u8(vld1q_u8(a + i + 16), vld1q_u8(b + i + 16)));
+        sum = vpadalq_u8(sum, vaddq_u8(c0, c1));
+    }
+    uint32x4_t wide = vpaddlq_u16(sum);
+    uint64x2_t wider = vpaddlq_u32(wide);
+    return static_cast<uint16_t>(vgetq_lane_u64(wider, 0) + vgetq_lane_u64(wider, 1));
+}
+
+static uint16_t hamming_bounded_neon(const uint8_t* a, const uint8_t* b, int bound) {
+    int result = 0;
+    for(int i=0; i<TEMPLATE_BYTES; i+=64) {
+        uint16x8_t sum = vdupq_n_u16(0);
+        for(int j=i; j<i+64; j+=32) {
+            uint8x16_t c0 = vcntq_u8(veorq_u8(vld1q_u8(a + j), vld1q_u8(b + j)));
+            uint8x16_t c1 = vcntq_u8(veorq_u8(vld1q_u8(a + j + 16), vld1q_u8(b + j + 16)));
+            sum = vpadalq_u8(sum, vaddq_u8(c0, c1));
+        }
+        uint64x2_t wider = vpaddlq_u32(vpaddlq_u16(sum));
+        result += static_cast<int>(vgetq_lane_u64(wider, 0) + vgetq_lane_u64(wider, 1));
+        if(result > bound) break;
+    }
+    return static_cast<uint16_t>(result);
+}
+
+static void hamming_1xN_neon(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out) {
+    uint8x16_t q[TEMPLATE_BYTES / 16];
+    for(int j=0; j<TEMPLATE_BYTES / 16; j++) q[j] = vld1q_u8(query + j * 16);
+    for(size_t t=0; t<count; t++) {
+        const uint8_t* row = bank + t * TEMPLATE_BYTES;
+        uint16x8_t sum = vdupq_n_u16(0);
+        for(int j=0; j<TEMPLATE_BYTES / 16; j+=2) {
+            uint8x16_t c0 = vcntq_u8(veorq_u8(q[j], vld1q_u8(row + j * 16)));
+            uint8x16_t c1 = vcntq_u8(veorq_u8(q[j + 1], vld1q_u8(row + j * 16 + 16)));
+            sum = vpadalq_u8(sum, vaddq_u8(c0, c1));
+        }
+        uint64x2_t wider = vpaddlq_u32(vpaddlq_u16(sum));
+        out[t] = static_cast<uint16_t>(vgetq_lane_u64(wider, 0) + vgetq_lane_u64(wider, 1));
+    }
+}
+#endif
+
+static HammingKernel select_hamming_kernel() {
+    std::vector<HammingKernel> available = available_hamming_kernels();
+    HammingKernel best = available.back();  // Ordered slowest to fastest
+
+    // Allow pinning a kernel by name (benchmarks, bug reports)
+    if (const char* forced = std::getenv("LR_HAMMING_KERNEL")) {
+        for (const auto& k : available) {
+            if (std::strcmp(k.name, forced) == 0) return k;
+        }
+        std::cerr << "Warning: LR_HAMMING_KERNEL=" << forced
+                  << " not available, using " << best.name << std::endl;
+    }
+    return best;
+}
+
+std::vector<HammingKernel> available_hamming_kernels() {
+    std::vector<HammingKernel> kernels;
+    kernels.push_back({"scalar", hamming_distance_scalar, hamming_1xN_scalar, hamming_bounded_scalar});
+    #if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("popcnt")) {
+        kernels.push_back({"popcnt", hamming_distance_popcnt, hamming_1xN_popcnt, hamming_bounded_popcnt});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", hamming_distance_avx2, hamming_1xN_avx2, hamming_bounded_avx2});
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+        kernels.push_back({"avx512", hamming_distance_avx512, hamming_1xN_avx512, hamming_bounded_avx512});
+    }
+    #elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+        kernels.push_back({"neon", hamming_distance_neon, hamming_1xN_neon, hamming_bounded_neon});
+    }
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+        kernels.push_back({"neon", hamming_distance_neon, hamming_1xN_neon, hamming_bounded_neon});
+    }
+    #endif
+    return kernels;
+}
+
+const HammingKernel& active_hamming_kernel() {
+    static const HammingKernel kernel = select_hamming_kernel();
+    return kernel;
+}
+
+// Resolved on first call (a function-local static, like the kernel itself),
+// so callers running during another file's static initialization are safe;
+// afterwards the hot path is a guard check and a plain indirect call
 uint16_t hamming_distance(const uint8_t* a, const uint8_t* b) {
-    #if defined(__arm__) || defined(__aarch64__)
-    // ARM NEON implementation for 512 bytes
-    uint8x16_t sum = vdupq_n_u8(0);
-    for(int i=0; i<512; i+=16) {
-        uint8x16_t va = vld1q_u8(a + i);
-        uint8x16_t vb = vld1q_u8(b + i);
-        uint8x16_t vc = veorq_u8(va, vb);
-        sum = vaddq_u8(sum, vcntq_u8(vc));
-    }
-    return vaddlvq_u8(sum);
-    #elif defined(__x86_64__) && defined(__SSE4_2__)
-    // x86_64 SSE implementation (only if SSE4.2 is available) for 512 bytes
-    __m128i sum = _mm_setzero_si128();
-    for(int i=0; i<512; i+=16) {
-        __m128i va = _mm_loadu_si128((__m128i*)(a + i));
-        __m128i vb = _mm_loadu_si128((__m128i*)(b + i));
-        __m128i vc = _mm_xor_si128(va, vb);
-        
-        // Count bits using popcnt (SSE4.2)
-        __m128i count = _mm_setzero_si128();
-        for(int j=0; j<16; j++) {
-            uint8_t byte = _mm_extract_epi8(vc, j);
-            count = _mm_insert_epi8(count, __builtin_popcount(byte), j);
+    static const HammingFn distance = active_hamming_kernel().distance;
+    return distance(a, b);
+}
+
+// A template block (32 x 512 = 16 KB) stays in a 32 KB L1 while every query
+// of the tile is compared to it; a query tile (256 x 512 = 128 KB, a whole
+// board is 49) stays in L2 while the template set streams past once.
+static const size_t MXN_TEMPLATE_BLOCK = 32;
+static const size_t MXN_QUERY_BLOCK = 256;
+
+void hamming_distances_MxN(const uint8_t* queries, size_t m,
+                           const uint8_t* bank, size_t n,
+                           uint16_t* out, size_t out_stride) {
+    Hamming1xNFn kernel = active_hamming_kernel().distances_1xN;
+    for(size_t q0=0; q0<m; q0+=MXN_QUERY_BLOCK) {
+        size_t q1 = std::min(m, q0 + MXN_QUERY_BLOCK);
+        for(size_t t0=0; t0<n; t0+=MXN_TEMPLATE_BLOCK) {
+            size_t nt = std::min(n - t0, MXN_TEMPLATE_BLOCK);
+            const uint8_t* block = bank + t0 * TEMPLATE_BYTES;
+            for(size_t q=q0; q<q1; q++) {
+                kernel(queries + q * TEMPLATE_BYTES, block, nt, out + q * out_stride + t0);
+            }
         }
-        sum = _mm_add_epi8(sum, count);
     }
-    
-    // Sum up the result
-    uint16_t result = 0;
-    for(int i=0; i<16; i++) {
-        result += _mm_extract_epi8(sum, i);
+}
+
+// Distances on the coarse pyramid levels (32 and 128 bytes). Too short for
+// wide SIMD to pay off; only hardware popcnt matters here.
+static uint16_t hamming_distance_bytes_scalar(const uint8_t* a, const uint8_t* b, size_t nbytes) {
+    uint32_t result = 0;
+    for(size_t i=0; i<nbytes; i+=8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        result += __builtin_popcountll(va ^ vb);
     }
-    return result;
-    #else
-    // Fallback implementation (works on all platforms) for 512 bytes
-    uint16_t result = 0;
-    for(int i=0; i<512; i++) {
-        uint8_t diff = a[i] ^ b[i];
-        result += __builtin_popcount(diff);
+    return static_cast<uint16_t>(result);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("popcnt")))
+static uint16_t hamming_distance_bytes_popcnt(const uint8_t* a, const uint8_t* b, size_t nbytes) {
+    uint64_t result = 0;
+    for(size_t i=0; i<nbytes; i+=8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        result += __builtin_popcountll(va ^ vb);
     }
-    return result;
+    return static_cast<uint16_t>(result);
+}
+#endif
+
+typedef uint16_t (*HammingBytesFn)(const uint8_t*, const uint8_t*, size_t);
+
+static HammingBytesFn select_hamming_bytes() {
+    #if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt")) return hamming_distance_bytes_popcnt;
     #endif
+    return hamming_distance_bytes_scalar;
+}
+
+uint16_t hamming_distance_bytes(const uint8_t* a, const uint8_t* b, size_t nbytes) {
+    static const HammingBytesFn distance = select_hamming_bytes();
+    return distance(a, b, nbytes);
+}
+
+// Keeps the even bits of x, packed into the low half
+static inline uint64_t compress_even_bits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+}
+
+void downsample_bitplane(const uint8_t* src, int src_size, uint8_t* dst) {
+    const int src_row_bytes = src_size / 8;
+    const int dst_row_bytes = src_size / 16;
+    for(int y=0; y<src_size/2; y++) {
+        uint64_t r0 = 0, r1 = 0;
+        std::memcpy(&r0, src + (2*y) * src_row_bytes, src_row_bytes);
+        std::memcpy(&r1, src + (2*y + 1) * src_row_bytes, src_row_bytes);
+        // Bits 2x and 2x+1 of both rows form output pixel x
+        uint64_t a = r0, b = r0 >> 1, c = r1, d = r1 >> 1;
+        // Set when at least 2 of the 4 source pixels are set, so one pixel
+        // wide strokes survive the downsampling
+        uint64_t at_least_two = (a & b) | (c & d) | ((a | b) & (c | d));
+        uint64_t row = compress_even_bits(at_least_two);
+        std::memcpy(dst + y * dst_row_bytes, &row, dst_row_bytes);
+    }
+}
+
+void build_pyramid(const uint8_t* bits, uint8_t* level32, uint8_t* level16) {
+    downsample_bitplane(bits, TEMPLATE_SIZE, level32);
+    downsample_bitplane(level32, TEMPLATE_SIZE / 2, level16);
+}
+
+// In-place 64x64 bit matrix transpose (Hacker's Delight 7-3): six rounds
+// swapping the off-diagonal blocks of 32, 16, ... 1 bits with masked
+// shifts. Bit x of rows[y] is pixel (x, y).
+static void transpose_rows(uint64_t* rows) {
+    uint64_t mask = 0x00000000FFFFFFFFull;
+    for(int j=32; j!=0; j>>=1, mask^=mask<<j) {
+        for(int k=0; k<64; k=((k|j)+1)&~j) {
+            uint64_t t = ((rows[k] >> j) ^ rows[k|j]) & mask;
+            rows[k] ^= t << j;
+            rows[k|j] ^= t;
+        }
+    }
+}
+
+// Mirrors a row: pixel x moves to 63 - x
+static uint64_t reverse_row(uint64_t row) {
+    row = ((row >> 1) & 0x5555555555555555ull) | ((row & 0x5555555555555555ull) << 1);
+    row = ((row >> 2) & 0x3333333333333333ull) | ((row & 0x3333333333333333ull) << 2);
+    row = ((row >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((row & 0x0F0F0F0F0F0F0F0Full) << 4);
+    return __builtin_bswap64(row);
+}
+
+void transpose_bitplane(const uint8_t* src, uint8_t* dst) {
+    uint64_t rows[TEMPLATE_SIZE];
+    std::memcpy(rows, src, TEMPLATE_BYTES);
+    transpose_rows(rows);
+    std::memcpy(dst, rows, TEMPLATE_BYTES);
+}
+
+void rotate_bitplane(const uint8_t* src, int degrees, uint8_t* dst) {
+    uint64_t rows[TEMPLATE_SIZE];
+    std::memcpy(rows, src, TEMPLATE_BYTES);
+    switch(degrees) {
+        case 90:   // Transpose, then mirror every row
+            transpose_rows(rows);
+            for(int y=0; y<TEMPLATE_SIZE; y++) rows[y] = reverse_row(rows[y]);
+            break;
+        case 180:  // Mirror rows and reverse their order
+            for(int y=0; y<TEMPLATE_SIZE/2; y++) {
+                uint64_t top = reverse_row(rows[y]);
+                rows[y] = reverse_row(rows[TEMPLATE_SIZE - 1 - y]);
+                rows[TEMPLATE_SIZE - 1 - y] = top;
+            }
+            break;
+        case 270:  // Transpose, then reverse the row order
+            transpose_rows(rows);
+            std::reverse(rows, rows + TEMPLATE_SIZE);
+            break;
+        default:
+            break;
+    }
+    std::memcpy(dst, rows, TEMPLATE_BYTES);
 }
 
 void adaptive_binarize(const cv::Mat& src, cv::Mat& dst) {
@@ -93,7 +520,121 @@ void adaptive_binarize(const cv::Mat& src, cv::Mat& dst) {
     }
 }
 
+// Bit x of the result is set when gray[x] > threshold (one 64-pixel row)
+static inline uint64_t threshold_row_mask(const uint8_t* gray, uint8_t threshold) {
+    #if defined(__x86_64__)
+    // No unsigned byte compare in SSE2: flip the sign bits and compare signed
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i t = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(threshold)), bias);
+    uint64_t mask = 0;
+    for(int i=0; i<4; i++) {
+        __m128i p = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(gray + i * 16)), bias);
+        uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(p, t)));
+        mask |= bits << (i * 16);
+    }
+    return mask;
+    #elif defined(__aarch64__)
+    const uint8x16_t t = vdupq_n_u8(threshold);
+    const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint64_t mask = 0;
+    for(int i=0; i<4; i++) {
+        uint8x16_t weighted = vandq_u8(vcgtq_u8(vld1q_u8(gray + i * 16), t), weights);
+        mask |= static_cast<uint64_t>(vaddv_u8(vget_low_u8(weighted))) << (i * 16);
+        mask |= static_cast<uint64_t>(vaddv_u8(vget_high_u8(weighted))) << (i * 16 + 8);
+    }
+    return mask;
+    #else
+    uint64_t mask = 0;
+    for(int x=0; x<64; x++) {
+        mask |= static_cast<uint64_t>(gray[x] > threshold) << x;
+    }
+    return mask;
+    #endif
+}
+
+// Centroid of 64 row masks, then each row lands at dy = y - cy + 32 shifted
+// by 32 - cx as a whole word: the same placement center_and_pack_reference
+// computes pixel by pixel, with out-of-range pixels falling off the ends.
+static void pack_centered_rows(const uint64_t* rows, uint8_t* out) {
+    // x moments from bit planes: sum of x over set bits = sum_b 2^b * popcount(row & plane_b)
+    static const uint64_t planes[6] = {
+        0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+    };
+    int cx = 0, cy = 0, count = 0;
+    for(int y=0; y<64; y++) {
+        uint64_t row = rows[y];
+        if(!row) continue;
+        int n = __builtin_popcountll(row);
+        count += n;
+        cy += y * n;
+        for(int b=0; b<6; b++) cx += __builtin_popcountll(row & planes[b]) << b;
+    }
+    cx = (count > 0) ? cx / count : 32;
+    cy = (count > 0) ? cy / count : 32;
+
+    uint64_t centered[64] = {};
+    int shift = 32 - cx;  // In [-31, 32]
+    for(int y=0; y<64; y++) {
+        int dy = y - cy + 32;
+        if(dy < 0 || dy >= 64) continue;
+        centered[dy] = shift >= 0 ? rows[y] << shift : rows[y] >> -shift;
+    }
+    // Row dy is bytes dy*8 .. dy*8+7, lowest x in the lowest bit (little-endian)
+    std::memcpy(out, centered, TEMPLATE_BYTES);
+}
+
 void center_and_pack(const cv::Mat& bin, std::vector<uint8_t>& packed) {
+    // One movemask word per row (non-zero pixels), then the centroid and
+    // centring shift on the 64 words. Every byte of `packed` is written.
+    uint64_t rows[64];
+    for(int y=0; y<64; y++) {
+        rows[y] = threshold_row_mask(bin.ptr<uint8_t>(y), 0);
+    }
+    packed.resize(TEMPLATE_BYTES);
+    pack_centered_rows(rows, packed.data());
+}
+
+void center_bitplane(const uint8_t* src, uint8_t* dst) {
+    uint64_t rows[TEMPLATE_SIZE];
+    std::memcpy(rows, src, TEMPLATE_BYTES);
+    pack_centered_rows(rows, dst);
+}
+
+// Horizontal moves are 64-bit shifts of each row word, vertical ones a row
+// offset; pixels pushed past an edge are dropped
+void shift_bitplane(const uint8_t* src, int dx, int dy, uint8_t* dst) {
+    uint64_t rows[TEMPLATE_SIZE];
+    std::memcpy(rows, src, TEMPLATE_BYTES);
+    uint64_t shifted[TEMPLATE_SIZE] = {};
+    for(int y=0; y<TEMPLATE_SIZE; y++) {
+        int sy = y - dy;
+        if(sy < 0 || sy >= TEMPLATE_SIZE) continue;
+        shifted[y] = dx >= 0 ? rows[sy] << dx : rows[sy] >> -dx;
+    }
+    std::memcpy(dst, shifted, TEMPLATE_BYTES);
+}
+
+size_t shifted_queries(const uint8_t* query, int radius, uint8_t* out) {
+    radius = std::max(0, std::min(radius, MAX_SHIFT_RADIUS));
+    std::memcpy(out, query, TEMPLATE_BYTES);
+    size_t n = 1;
+    // Rings of growing Chebyshev distance, so the closest offsets set the
+    // pruning bound for the rest
+    for(int ring=1; ring<=radius; ring++) {
+        for(int dy=-ring; dy<=ring; dy++) {
+            for(int dx=-ring; dx<=ring; dx++) {
+                if(std::max(std::abs(dx), std::abs(dy)) != ring) continue;
+                shift_bitplane(query, dx, dy, out + n * TEMPLATE_BYTES);
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+// Pixel-by-pixel original of center_and_pack, kept for equivalence tests
+void center_and_pack_reference(const cv::Mat& bin, std::vector<uint8_t>& packed) {
     // Centroid calculation for 64x64
     int cx = 0, cy = 0, count = 0;
     for(int y=0; y<64; y++) {
@@ -107,7 +648,7 @@ void center_and_pack(const cv::Mat& bin, std::vector<uint8_t>& packed) {
     cy = (count > 0) ? cy / count : 32;
     
     // Pack into 512 bytes (4096 bits = 64x64)
-    packed.resize(512, 0);
+    packed.assign(512, 0);
     for(int y=0; y<64; y++) {
         for(int x=0; x<64; x++) {
             int dx = x - cx + 32;
@@ -124,68 +665,206 @@ void center_and_pack(const cv::Mat& bin, std::vector<uint8_t>& packed) {
     }
 }
 
-void load_templates(const std::string& path) {
-    templates.clear();
-    std::ifstream file(path);
+void preprocess_glyph_reference(const cv::Mat& image, GlyphScratch& scratch, uint8_t* out) {
+    cv::resize(image, scratch.resized, cv::Size(64, 64));
+    adaptive_binarize(scratch.resized, scratch.binary);
+    center_and_pack_reference(scratch.binary, scratch.packed);
+    std::memcpy(out, scratch.packed.data(), TEMPLATE_BYTES);
+}
+
+// Fused version of preprocess_glyph_reference. After the resize (skipped
+// for tiles that are already 64x64, e.g. board cells) it makes two passes
+// over 4096 pixels: BGR -> gray with cvtColor's fixed-point weights plus
+// the sum for the mean threshold, then one compare + movemask per 16
+// pixels into 64 row masks. Polarity comes from the popcount of those
+// masks (a whole-row invert), and the centroid and shift work on the 64
+// words. No 0/255 image and no per-pixel bounds checks.
+void preprocess_glyph(const cv::Mat& image, GlyphScratch& scratch, uint8_t* out) {
+    const cv::Mat* tile = &image;
+    if (image.rows != TEMPLATE_SIZE || image.cols != TEMPLATE_SIZE) {
+        cv::resize(image, scratch.resized, cv::Size(TEMPLATE_SIZE, TEMPLATE_SIZE));
+        tile = &scratch.resized;
+    }
+
+    // Pass 1: gray tile + sum (OpenCV's BGR2GRAY: 14-bit fixed point, rounded)
+    alignas(64) uint8_t gray[TEMPLATE_SIZE * TEMPLATE_SIZE];
+    const int channels = tile->channels();
+    uint32_t sum = 0;
+    for(int y=0; y<TEMPLATE_SIZE; y++) {
+        const uint8_t* src = tile->ptr<uint8_t>(y);
+        uint8_t* dst = gray + y * TEMPLATE_SIZE;
+        if (channels == 1) {
+            for(int x=0; x<TEMPLATE_SIZE; x++) dst[x] = src[x];
+        } else {
+            for(int x=0; x<TEMPLATE_SIZE; x++, src += channels) {
+                dst[x] = static_cast<uint8_t>((src[0] * 1868 + src[1] * 9617 + src[2] * 4899 + (1 << 13)) >> 14);
+            }
+        }
+        for(int x=0; x<TEMPLATE_SIZE; x++) sum += dst[x];
+    }
+    uint8_t threshold = sum >> 12;  // Divide by 4096
+
+    // Pass 2: pixels above the mean as row masks
+    uint64_t rows[TEMPLATE_SIZE];
+    int above_threshold = 0;
+    for(int y=0; y<TEMPLATE_SIZE; y++) {
+        rows[y] = threshold_row_mask(gray + y * TEMPLATE_SIZE, threshold);
+        above_threshold += __builtin_popcountll(rows[y]);
+    }
+
+    // Same polarity rule as adaptive_binarize: more dark pixels means dark letters
+    if (TEMPLATE_SIZE * TEMPLATE_SIZE - above_threshold > above_threshold) {
+        for(int y=0; y<TEMPLATE_SIZE; y++) rows[y] = ~rows[y];
+    }
+
+    pack_centered_rows(rows, out);
+}
+
+// Packs TEMPLATE_SIZE * TEMPLATE_SIZE '0'/'1' characters into a bitplane
+// laid out like center_and_pack: character i is bit i % 8 of byte i / 8.
+// Anything other than '1' reads as 0.
+void pack_bit_string(const char* chars, uint8_t* bits) {
+    #if defined(__x86_64__)
+    // SSE2 is part of x86_64: 16 characters -> 16-bit movemask -> 2 bytes
+    const __m128i one = _mm_set1_epi8('1');
+    for(int i=0; i<TEMPLATE_BYTES; i+=2) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars + i * 8));
+        uint16_t mask = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, one)));
+        std::memcpy(bits + i, &mask, 2);
+    }
+    #elif defined(__aarch64__)
+    // No movemask on NEON: weight each lane by its bit and add across 8 lanes
+    const uint8x16_t one = vdupq_n_u8('1');
+    const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    for(int i=0; i<TEMPLATE_BYTES; i+=2) {
+        uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t*>(chars + i * 8));
+        uint8x16_t weighted = vandq_u8(vceqq_u8(c, one), weights);
+        bits[i] = vaddv_u8(vget_low_u8(weighted));
+        bits[i + 1] = vaddv_u8(vget_high_u8(weighted));
+    }
+    #else
+    for(int i=0; i<TEMPLATE_BYTES; i++) {
+        uint8_t byte = 0;
+        for(int b=0; b<8; b++) {
+            byte |= static_cast<uint8_t>(chars[i * 8 + b] == '1') << b;
+        }
+        bits[i] = byte;
+    }
+    #endif
+}
+
+// Text format, one template per line: <letter>_<rotation>,<4096 x '0'/'1'>
+// The file is read with a single bulk read and parsed in place.
+std::vector<Template> read_templates_text(const std::string& path) {
+    std::vector<Template> loaded;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open templates file: " + path);
     }
     
-    std::string line;
+    std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+    
+    const int bit_count = TEMPLATE_SIZE * TEMPLATE_SIZE;
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
     int line_number = 0;
     
-    while(std::getline(file, line)) {
+    while(p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = newline ? newline : end;
+        const char* next = newline ? newline + 1 : end;
         line_number++;
-        if(line.empty()) continue;
+        if (line_end > p && line_end[-1] == '\r') line_end--;
+        
+        size_t length = line_end - p;
+        if(length == 0) {
+            p = next;
+            continue;
+        }
         
         // Check if line has minimum required length
-        if (line.length() < 3) {
-            std::cerr << "Warning: Skipping invalid line " << line_number << ": " << line << std::endl;
+        if (length < 3) {
+            std::cerr << "Warning: Skipping invalid line " << line_number << std::endl;
+            p = next;
             continue;
         }
         
         Template t;
-        t.letter = line[0];
+        t.letter = p[0];
         
         // Find the comma to separate rotation from binary data
-        size_t comma_pos = line.find(',');
-        if (comma_pos == std::string::npos) {
-            std::cerr << "Warning: Skipping line " << line_number << " (no comma found): " << line << std::endl;
+        const char* comma = static_cast<const char*>(std::memchr(p, ',', length));
+        if (!comma) {
+            std::cerr << "Warning: Skipping line " << line_number << " (no comma found)" << std::endl;
+            p = next;
             continue;
         }
         
-        // Parse rotation number
-        std::string rotation_str = line.substr(2, comma_pos - 2);
-        try {
-            t.rotation = std::stoi(rotation_str);
-        } catch (const std::invalid_argument& e) {
-            std::cerr << "Warning: Invalid rotation number '" << rotation_str << "' in line " << line_number << ": " << line << std::endl;
+        // Parse rotation number (a comma at p[1], as in "A,0101...", leaves
+        // no rotation field and must not reach from_chars as first > last)
+        if (comma <= p + 2) {
+            std::cerr << "Warning: Missing rotation number in line " << line_number << std::endl;
+            p = next;
             continue;
-        } catch (const std::out_of_range& e) {
-            std::cerr << "Warning: Rotation number out of range '" << rotation_str << "' in line " << line_number << ": " << line << std::endl;
+        }
+        auto parsed = std::from_chars(p + 2, comma, t.rotation);
+        if (parsed.ec != std::errc() || parsed.ptr != comma) {
+            std::cerr << "Warning: Invalid rotation number '" << std::string(p + 2, comma)
+                      << "' in line " << line_number << std::endl;
+            p = next;
             continue;
         }
         
         // Parse binary string
-        std::string bits_str = line.substr(comma_pos + 1);
-        if (bits_str.length() < 512) {
-            std::cerr << "Warning: Binary string too short in line " << line_number << ": " << line << std::endl;
+        const char* bits_str = comma + 1;
+        if (line_end - bits_str < bit_count) {
+            std::cerr << "Warning: Binary string too short in line " << line_number
+                      << " (" << (line_end - bits_str) << " of " << bit_count << " bits)" << std::endl;
+            p = next;
             continue;
         }
         
-        t.bits.resize(512);
-        for(int i=0; i<512; i++) {
-            t.bits[i] = (bits_str[i] == '1') ? 0xFF : 0x00;
-        }
-        
-        templates.push_back(t);
+        t.bits.resize(TEMPLATE_BYTES);
+        pack_bit_string(bits_str, t.bits.data());
+        loaded.push_back(std::move(t));
+        p = next;
     }
     
+    return loaded;
+}
+
+void load_templates(const std::string& path) {
+    templates = read_templates_text(path);
+    rebuild_template_bank();
     std::cout << "Loaded " << templates.size() << " templates from " << path << std::endl;
 }
 
-void load_templates_binary(const std::string& path) {
-    templates.clear();
+void save_templates_text(const std::string& path, const std::vector<Template>& list) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not write templates file: " + path);
+    }
+    
+    std::string line;
+    for (const auto& t : list) {
+        line.assign(1, t.letter);
+        line += '_';
+        line += std::to_string(t.rotation);
+        line += ',';
+        for (int i = 0; i < TEMPLATE_SIZE * TEMPLATE_SIZE; i++) {
+            bool set = static_cast<size_t>(i / 8) < t.bits.size() && ((t.bits[i / 8] >> (i % 8)) & 1);
+            line += set ? '1' : '0';
+        }
+        line += '\n';
+        out.write(line.data(), line.size());
+    }
+}
+
+// Legacy record format: letter (1 byte), rotation (int), 512 bytes of bits
+std::vector<Template> read_templates_binary(const std::string& path) {
+    std::vector<Template> loaded;
     std::ifstream file(path, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open binary templates file: " + path);
@@ -204,163 +883,383 @@ void load_templates_binary(const std::string& path) {
         t.bits.resize(512);
         if (!file.read(reinterpret_cast<char*>(t.bits.data()), 512)) break;
         
-        templates.push_back(t);
+        loaded.push_back(t);
     }
     
+    return loaded;
+}
+
+void load_templates_binary(const std::string& path) {
+    // Versioned bank files are mapped; `templates` is still filled for
+    // callers that read it (load_template_bank skips that copy)
+    if (TemplateBank::is_bank_file(path)) {
+        load_template_bank(path);
+        std::shared_ptr<const TemplateBank> bank = template_bank();
+        std::vector<Template> loaded;
+        loaded.reserve(bank->size());
+        for (size_t i = 0; i < bank->size(); i++) {
+            Template t;
+            t.letter = bank->letter(i);
+            t.rotation = bank->rotation(i);
+            t.bits.assign(bank->bits(i), bank->bits(i) + TEMPLATE_BYTES);
+            loaded.push_back(std::move(t));
+        }
+        templates = std::move(loaded);
+        std::cout << "Loaded " << templates.size() << " templates from " << path << std::endl;
+        return;
+    }
+    
+    templates = read_templates_binary(path);
+    rebuild_template_bank();
     std::cout << "Loaded " << templates.size() << " templates from " << path << std::endl;
 }
 
+bool parse_template_filename(const std::string& stem, char& letter, int& rotation) {
+    // <letter>_<rotation>_<n>; the letter field may be longer ("div"), only
+    // its first character is kept
+    size_t first_underscore = stem.find('_');
+    if (first_underscore == std::string::npos || first_underscore == 0) return false;
+    size_t second_underscore = stem.find('_', first_underscore + 1);
+    if (second_underscore == std::string::npos) return false;
+    const char* begin = stem.data() + first_underscore + 1;
+    const char* end = stem.data() + second_underscore;
+    auto parsed = std::from_chars(begin, end, rotation);
+    if (parsed.ec != std::errc() || parsed.ptr != end) return false;
+    letter = stem[0];
+    return true;
+}
+
+std::vector<Template> read_templates_dataset(const std::string& dir, bool upright_only) {
+    if (!std::filesystem::is_directory(dir)) {
+        throw std::runtime_error("Could not open dataset directory: " + dir);
+    }
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".jpg") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Template> loaded;
+    cv::Mat resized, binary;
+    for (const auto& path : paths) {
+        Template t;
+        if (!parse_template_filename(path.stem().string(), t.letter, t.rotation)) {
+            std::cerr << "Warning: Skipping file with invalid format: " << path.filename().string() << std::endl;
+            continue;
+        }
+        if (upright_only && t.rotation != 0) continue;
+
+        cv::Mat img = cv::imread(path.string());
+        if (img.empty()) {
+            std::cerr << "Warning: Could not read " << path.string() << std::endl;
+            continue;
+        }
+        cv::resize(img, resized, cv::Size(TEMPLATE_SIZE, TEMPLATE_SIZE));
+        adaptive_binarize(resized, binary);
+        center_and_pack(binary, t.bits);
+        loaded.push_back(std::move(t));
+    }
+    return loaded;
+}
+
+// The free functions below run a Recognizer over the global bank and the
+// current globals, so SAFE_THRESHOLD etc. are read at call time
+template<size_t K>
+std::array<RecognitionResult, K> recognize_letter_top_k(const cv::Mat& image) {
+    return default_recognizer().recognize_top_k<K>(image);
+}
+
+// Instantiations exported through letter_recognition.h
+template std::array<RecognitionResult, 1> recognize_letter_top_k<1>(const cv::Mat&);
+template std::array<RecognitionResult, 2> recognize_letter_top_k<2>(const cv::Mat&);
+template std::array<RecognitionResult, 3> recognize_letter_top_k<3>(const cv::Mat&);
+template std::array<RecognitionResult, 5> recognize_letter_top_k<5>(const cv::Mat&);
+template std::array<RecognitionResult, 10> recognize_letter_top_k<10>(const cv::Mat&);
+
 char recognize_letter(const cv::Mat& image) {
-    // Debug: Print input image info
-    std::cout << "Input image: " << image.cols << "x" << image.rows << " channels: " << image.channels() << std::endl;
-    
-    // Resize image to 64x64 (same as templates)
-    cv::Mat resized;
-    cv::resize(image, resized, cv::Size(64, 64));
-    
-    // Debug: Save resized image
-    debug_save_image(resized, "debug_resized.jpg");
-    
-    cv::Mat binary;
-    adaptive_binarize(resized, binary);
-    
-    // Debug: Save binary image
-    debug_save_image(binary, "debug_binary.jpg");
-    
-    std::vector<uint8_t> packed;
-    center_and_pack(binary, packed);
-    
-    // Debug: Check packed data
-    std::cout << "Packed data size: " << packed.size() << " bytes" << std::endl;
-    int non_zero_bytes = 0;
-    for (int i = 0; i < packed.size(); i++) {
-        if (packed[i] != 0) non_zero_bytes++;
+    return recognize_letter_with_rotation(image).letter;
+}
+
+RecognitionResult recognize_letter_with_rotation(const cv::Mat& image) {
+    return default_recognizer().recognize(image);
+}
+
+std::vector<RecognitionResult> recognize_letters(const std::vector<cv::Mat>& glyphs) {
+    return default_recognizer().recognize_all(glyphs);
+}
+
+// Distances run 0..4096: one histogram bin each
+static const int DISTANCE_BINS = TEMPLATE_SIZE * TEMPLATE_SIZE + 1;
+// Glyphs per MxN call (x4 orientations = one MXN_QUERY_BLOCK) and templates
+// per pass, so the distance tile stays small whatever the bank size
+static const size_t CALIBRATION_QUERY_BLOCK = 64;
+static const size_t CALIBRATION_TEMPLATE_BLOCK = 4096;
+
+// Largest threshold whose impostor rate stays within target_far;
+// REJECT_ALL_THRESHOLD when the impostors at distance 0 alone exceed it
+static int threshold_for_far(const uint64_t* impostor, double target_far) {
+    uint64_t total = 0;
+    for (int d = 0; d < DISTANCE_BINS; d++) total += impostor[d];
+    if (total == 0) return DISTANCE_BINS - 1;
+    const double allowed = target_far * total;
+    uint64_t accepted = 0;
+    for (int d = 0; d < DISTANCE_BINS; d++) {
+        accepted += impostor[d];
+        if (accepted > allowed) return d == 0 ? REJECT_ALL_THRESHOLD : d - 1;
     }
-    std::cout << "Non-zero bytes in packed data: " << non_zero_bytes << std::endl;
-    
-    char best_match = '?';
-    int min_distance = INT_MAX;
-    
-    // Debug: Check if templates are loaded
-    if (templates.empty()) {
-        std::cerr << "Warning: No templates loaded!" << std::endl;
-        return '?';
+    return DISTANCE_BINS - 1;
+}
+
+ThresholdCalibration calibrate_threshold(const TemplateBank& bank, const uint8_t* queries,
+                                         const char* letters, size_t count, double target_far) {
+    ThresholdCalibration calibration;
+    calibration.target_far = target_far;
+
+    // Histogram slot of every letter in the bank
+    std::array<int, 256> slot;
+    slot.fill(-1);
+    std::vector<char> bank_letters;
+    for (size_t t = 0; t < bank.size(); t++) {
+        unsigned char letter = static_cast<unsigned char>(bank.letter(t));
+        if (slot[letter] < 0) {
+            slot[letter] = static_cast<int>(bank_letters.size());
+            bank_letters.push_back(bank.letter(t));
+        }
     }
-    
-    // Debug: Print template stats
-    debug_print_template_stats();
-    
-    for(const auto& t : templates) {
-        int distance = hamming_distance(packed.data(), t.bits.data());
-        if(distance < min_distance) {
-            min_distance = distance;
-            best_match = t.letter;
+    const size_t slots = bank_letters.size();
+    // A bank of 0° templates is matched in four orientations, like Recognizer
+    const size_t orientations = bank.upright_only() ? 4 : 1;
+
+    // Per glyph: its best distance to each letter. Its own letter's is the
+    // genuine distance, every other letter's an impostor distance.
+    std::vector<uint64_t> genuine(DISTANCE_BINS), impostor(DISTANCE_BINS), letter_impostor(slots * DISTANCE_BINS);
+    const long blocks = static_cast<long>((count + CALIBRATION_QUERY_BLOCK - 1) / CALIBRATION_QUERY_BLOCK);
+    #pragma omp parallel
+    {
+        std::vector<uint64_t> local_genuine(DISTANCE_BINS), local_impostor(DISTANCE_BINS);
+        std::vector<uint64_t> local_letter(slots * DISTANCE_BINS);
+        std::vector<uint8_t> rows(CALIBRATION_QUERY_BLOCK * orientations * TEMPLATE_BYTES);
+        std::vector<uint16_t> distances(CALIBRATION_QUERY_BLOCK * orientations * CALIBRATION_TEMPLATE_BLOCK);
+        std::vector<uint16_t> best(CALIBRATION_QUERY_BLOCK * slots);
+
+        #pragma omp for schedule(dynamic)
+        for (long b = 0; b < blocks; b++) {
+            const size_t first = b * CALIBRATION_QUERY_BLOCK;
+            const size_t m = std::min(CALIBRATION_QUERY_BLOCK, count - first);
+            for (size_t q = 0; q < m; q++) {
+                const uint8_t* query = queries + (first + q) * TEMPLATE_BYTES;
+                uint8_t* row = rows.data() + q * orientations * TEMPLATE_BYTES;
+                std::memcpy(row, query, TEMPLATE_BYTES);
+                for (size_t r = 1; r < orientations; r++) {
+                    uint8_t* turned = row + r * TEMPLATE_BYTES;
+                    rotate_bitplane(query, 360 - 90 * static_cast<int>(r), turned);
+                    center_bitplane(turned, turned);
+                }
+            }
+            std::fill(best.begin(), best.begin() + m * slots, static_cast<uint16_t>(DISTANCE_BINS - 1));
+            for (size_t t0 = 0; t0 < bank.size(); t0 += CALIBRATION_TEMPLATE_BLOCK) {
+                const size_t n = std::min(CALIBRATION_TEMPLATE_BLOCK, bank.size() - t0);
+                hamming_distances_MxN(rows.data(), m * orientations, bank.bits(t0), n, distances.data(), n);
+                for (size_t q = 0; q < m; q++) {
+                    uint16_t* query_best = best.data() + q * slots;
+                    for (size_t r = 0; r < orientations; r++) {
+                        const uint16_t* row = distances.data() + (q * orientations + r) * n;
+                        for (size_t t = 0; t < n; t++) {
+                            uint16_t& nearest = query_best[slot[static_cast<unsigned char>(bank.letter(t0 + t))]];
+                            nearest = std::min(nearest, row[t]);
+                        }
+                    }
+                }
+            }
+            for (size_t q = 0; q < m; q++) {
+                const uint16_t* query_best = best.data() + q * slots;
+                const int own = slot[static_cast<unsigned char>(letters[first + q])];
+                for (size_t s = 0; s < slots; s++) {
+                    if (static_cast<int>(s) == own) {
+                        local_genuine[query_best[s]]++;
+                    } else {
+                        local_impostor[query_best[s]]++;
+                        local_letter[s * DISTANCE_BINS + query_best[s]]++;
+                    }
+                }
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int d = 0; d < DISTANCE_BINS; d++) {
+                genuine[d] += local_genuine[d];
+                impostor[d] += local_impostor[d];
+            }
+            for (size_t i = 0; i < local_letter.size(); i++) letter_impostor[i] += local_letter[i];
         }
     }
-    
-    // Debug: Print distance information
-    std::cout << "Min distance: " << min_distance << " (threshold: " << SAFE_THRESHOLD << ")" << std::endl;
-    std::cout << "Best match: " << best_match << std::endl;
-    
-    // Debug: Print top 5 matches
-    std::vector<std::pair<char, int>> distances;
-    for(const auto& t : templates) {
-        int distance = hamming_distance(packed.data(), t.bits.data());
-        distances.push_back({t.letter, distance});
-    }
-    std::sort(distances.begin(), distances.end(), 
-              [](const auto& a, const auto& b) { return a.second < b.second; });
-    
-    std::cout << "Top 5 matches:" << std::endl;
-    for (int i = 0; i < std::min(5, (int)distances.size()); i++) {
-        std::cout << "  " << distances[i].first << ": " << distances[i].second << std::endl;
+
+    for (int d = 0; d < DISTANCE_BINS; d++) {
+        calibration.genuine += genuine[d];
+        calibration.impostor += impostor[d];
     }
-    
-    return (min_distance <= SAFE_THRESHOLD) ? best_match : '?';
+    if (calibration.impostor == 0) {
+        std::cerr << "Warning: No impostor distances (fewer than two letters); threshold not calibrated" << std::endl;
+        return calibration;
+    }
+
+    // ROC sweep: rates at every threshold, reported every ROC_STEP. The
+    // rates start as those of REJECT_ALL_THRESHOLD (nothing accepted).
+    uint64_t genuine_accepted = 0, impostor_accepted = 0;
+    calibration.threshold = threshold_for_far(impostor.data(), target_far);
+    calibration.false_accept_rate = 0.0;
+    calibration.false_reject_rate = calibration.genuine ? 1.0 : 0.0;
+    if (calibration.threshold == REJECT_ALL_THRESHOLD) {
+        std::cerr << "Warning: Impostors at distance 0 already exceed FAR " << target_far
+                  << "; the calibrated threshold rejects every glyph" << std::endl;
+    }
+    for (int d = 0; d < DISTANCE_BINS; d++) {
+        genuine_accepted += genuine[d];
+        impostor_accepted += impostor[d];
+        double far = static_cast<double>(impostor_accepted) / calibration.impostor;
+        double frr = calibration.genuine ? 1.0 - static_cast<double>(genuine_accepted) / calibration.genuine : 0.0;
+        if (d == calibration.threshold) {
+            calibration.false_accept_rate = far;
+            calibration.false_reject_rate = frr;
+        }
+        bool last = far >= 1.0;
+        if (d % ThresholdCalibration::ROC_STEP == 0 || last) {
+            calibration.roc.push_back({d, far, frr});
+        }
+        if (last) break;
+    }
+
+    auto table = std::make_shared<LetterThresholds>();
+    table->fill(DISTANCE_BINS - 1);
+    calibration.letter_threshold_max = REJECT_ALL_THRESHOLD;
+    size_t rejected_letters = 0;
+    for (size_t s = 0; s < slots; s++) {
+        int threshold = threshold_for_far(letter_impostor.data() + s * DISTANCE_BINS, target_far);
+        (*table)[static_cast<unsigned char>(bank_letters[s])] = threshold;
+        calibration.letter_threshold_max = std::max(calibration.letter_threshold_max, threshold);
+        if (threshold == REJECT_ALL_THRESHOLD) rejected_letters++;
+    }
+    if (rejected_letters > 0) {
+        std::cerr << "Warning: " << rejected_letters << " letter(s) cannot reach FAR " << target_far
+                  << " at any threshold; their per-letter threshold rejects every match" << std::endl;
+    }
+    calibration.letter_thresholds = table;
+    return calibration;
 }
 
-RecognitionResult recognize_letter_with_rotation(const cv::Mat& image) {
-    // Debug: Print input image info
-    std::cout << "Input image: " << image.cols << "x" << image.rows << " channels: " << image.channels() << std::endl;
-    
-    // Resize image to 64x64 (same as templates)
-    cv::Mat resized;
-    cv::resize(image, resized, cv::Size(64, 64));
-    
-    // Debug: Save resized image
-    debug_save_image(resized, "debug_resized.jpg");
-    
-    cv::Mat binary;
-    adaptive_binarize(resized, binary);
-    
-    // Debug: Save binary image
-    debug_save_image(binary, "debug_binary.jpg");
-    
-    std::vector<uint8_t> packed;
-    center_and_pack(binary, packed);
-    
-    // Debug: Check packed data
-    std::cout << "Packed data size: " << packed.size() << " bytes" << std::endl;
-    int non_zero_bytes = 0;
-    for (int i = 0; i < packed.size(); i++) {
-        if (packed[i] != 0) non_zero_bytes++;
+ThresholdCalibration calibrate_threshold(const std::string& validation_dir, double target_far) {
+    if (!std::filesystem::is_directory(validation_dir)) {
+        throw std::runtime_error("Could not open validation directory: " + validation_dir);
     }
-    std::cout << "Non-zero bytes in packed data: " << non_zero_bytes << std::endl;
-    
-    RecognitionResult best_result;
-    
-    // Debug: Check if templates are loaded
-    if (templates.empty()) {
-        std::cerr << "Warning: No templates loaded!" << std::endl;
-        return best_result;
+    std::vector<std::filesystem::path> paths;
+    std::vector<char> labels;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(validation_dir)) {
+        std::string ext = entry.path().extension().string();
+        if (!entry.is_regular_file() || (ext != ".jpg" && ext != ".png")) continue;
+        char letter;
+        int rotation;
+        if (!parse_template_filename(entry.path().stem().string(), letter, rotation)) continue;
+        paths.push_back(entry.path());
+        labels.push_back(letter);
     }
-    
-    // Debug: Print template stats
-    debug_print_template_stats();
-    
-    // Find the best matching template (including rotation)
-    for(const auto& t : templates) {
-        int distance = hamming_distance(packed.data(), t.bits.data());
-        if(distance < best_result.confidence) {
-            best_result.letter = t.letter;
-            best_result.rotation = t.rotation;
-            best_result.confidence = distance;
+
+    // Decode + preprocess in parallel, one scratch per thread
+    std::vector<uint8_t> queries(paths.size() * TEMPLATE_BYTES);
+    std::vector<char> readable(paths.size(), 0);
+    #pragma omp parallel
+    {
+        GlyphScratch scratch;
+        #pragma omp for schedule(dynamic)
+        for (long i = 0; i < static_cast<long>(paths.size()); i++) {
+            cv::Mat image = cv::imread(paths[i].string());
+            if (image.empty()) continue;
+            preprocess_glyph(image, scratch, queries.data() + i * TEMPLATE_BYTES);
+            readable[i] = 1;
         }
     }
-    
-    // Debug: Print distance information
-    std::cout << "Min distance: " << best_result.confidence << " (threshold: " << SAFE_THRESHOLD << ")" << std::endl;
-    std::cout << "Best match: " << best_result.letter << " (rotation: " << best_result.rotation << "°)" << std::endl;
-    
-    // Debug: Print top 5 matches with rotation
-    std::vector<std::pair<RecognitionResult, int>> distances;
-    for(const auto& t : templates) {
-        int distance = hamming_distance(packed.data(), t.bits.data());
-        RecognitionResult result(t.letter, t.rotation, distance);
-        distances.push_back({result, distance});
-    }
-    std::sort(distances.begin(), distances.end(), 
-              [](const auto& a, const auto& b) { return a.second < b.second; });
-    
-    std::cout << "Top 5 matches (with rotation):" << std::endl;
-    for (int i = 0; i < std::min(5, (int)distances.size()); i++) {
-        const auto& result = distances[i].first;
-        std::cout << "  " << result.letter << " (rotation: " << result.rotation << "°): " << result.confidence << std::endl;
+    size_t count = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!readable[i]) continue;
+        std::memmove(queries.data() + count * TEMPLATE_BYTES, queries.data() + i * TEMPLATE_BYTES, TEMPLATE_BYTES);
+        labels[count++] = labels[i];
     }
-    
-    // If confidence is too low, mark as unknown
-    if (best_result.confidence > SAFE_THRESHOLD) {
-        best_result.letter = '?';
-        best_result.rotation = 0;
+    if (count == 0) {
+        throw std::runtime_error("No labelled validation images in " + validation_dir);
     }
-    
-    return best_result;
+
+    ThresholdCalibration calibration = calibrate_threshold(*template_bank(), queries.data(), labels.data(), count, target_far);
+    SAFE_THRESHOLD = calibration.threshold;
+    return calibration;
 }
 
-void calibrate_threshold(const std::string& validation_dir) {
-    // Simple threshold calibration based on validation data
-    // This could be enhanced with machine learning
-    SAFE_THRESHOLD = 200;  // Updated for 64x64 templates
+void save_threshold_calibration(const std::string& path, const ThresholdCalibration& calibration) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not write thresholds file: " + path);
+    }
+    out << "# Reject thresholds: " << calibration.genuine << " genuine, " << calibration.impostor
+        << " impostor distances\n";
+    out << "target_far " << calibration.target_far << "\n";
+    out << "threshold " << calibration.threshold << "\n";
+    out << "far " << calibration.false_accept_rate << "\n";
+    out << "frr " << calibration.false_reject_rate << "\n";
+    out << "genuine " << calibration.genuine << "\n";
+    out << "impostor " << calibration.impostor << "\n";
+    if (calibration.letter_thresholds) {
+        const LetterThresholds& table = *calibration.letter_thresholds;
+        for (int c = 33; c < 127; c++) {
+            if (table[c] != DISTANCE_BINS - 1) out << "letter " << static_cast<char>(c) << " " << table[c] << "\n";
+        }
+    }
+    for (const auto& point : calibration.roc) {
+        out << "roc " << point.threshold << " " << point.false_accept_rate << " " << point.false_reject_rate << "\n";
+    }
+}
+
+ThresholdCalibration load_threshold_calibration(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open thresholds file: " + path);
+    }
+    ThresholdCalibration calibration;
+    std::shared_ptr<LetterThresholds> table;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        if (!(fields >> key)) continue;
+        if (key == "target_far") fields >> calibration.target_far;
+        else if (key == "threshold") fields >> calibration.threshold;
+        else if (key == "far") fields >> calibration.false_accept_rate;
+        else if (key == "frr") fields >> calibration.false_reject_rate;
+        else if (key == "genuine") fields >> calibration.genuine;
+        else if (key == "impostor") fields >> calibration.impostor;
+        else if (key == "letter") {
+            char letter;
+            int threshold;
+            if (!(fields >> letter >> threshold)) {
+                throw std::runtime_error("Bad letter line in thresholds file: " + path);
+            }
+            if (!table) {
+                table = std::make_shared<LetterThresholds>();
+                table->fill(DISTANCE_BINS - 1);
+                calibration.letter_threshold_max = REJECT_ALL_THRESHOLD;
+            }
+            (*table)[static_cast<unsigned char>(letter)] = threshold;
+            calibration.letter_threshold_max = std::max(calibration.letter_threshold_max, threshold);
+        } else if (key == "roc") {
+            ThresholdCalibration::RocPoint point;
+            fields >> point.threshold >> point.false_accept_rate >> point.false_reject_rate;
+            calibration.roc.push_back(point);
+        }
+        if (fields.fail()) {
+            throw std::runtime_error("Bad line in thresholds file " + path + ": " + line);
+        }
+    }
+    calibration.letter_thresholds = table;
+    return calibration;
 }
 
 void debug_save_image(const cv::Mat& img, const std::string& filename) {
@@ -373,15 +1272,19 @@ void debug_save_image(const cv::Mat& img, const std::string& filename) {
 }
 
 void debug_print_template_stats() {
+    debug_print_template_stats(*template_bank());
+}
+
+void debug_print_template_stats(const TemplateBank& bank) {
     std::cout << "Template Statistics:" << std::endl;
-    std::cout << "  Total templates: " << templates.size() << std::endl;
+    std::cout << "  Total templates: " << bank.size() << std::endl;
     
-    if (templates.empty()) return;
+    if (bank.empty()) return;
     
     // Count templates per letter
     std::map<char, int> letter_counts;
-    for (const auto& t : templates) {
-        letter_counts[t.letter]++;
+    for (size_t i = 0; i < bank.size(); i++) {
+        letter_counts[bank.letter(i)]++;
     }
     
     std::cout << "  Templates per letter:" << std::endl;
@@ -389,10 +1292,21 @@ void debug_print_template_stats() {
         std::cout << "    " << pair.first << ": " << pair.second << std::endl;
     }
     
-    // Check template data validity
-    int valid_templates = 0;
-    for (const auto& t : templates) {
-        if (t.bits.size() == 128) valid_templates++;
+    // Check template data validity (a blank bitplane matches nothing useful)
+    int blank_templates = 0;
+    for (size_t i = 0; i < bank.size(); i++) {
+        if (bank.popcount(i) == 0) blank_templates++;
+    }
+    std::cout << "  Blank templates: " << blank_templates << "/" << bank.size() << std::endl;
+
+    // Class index: tighter classes prune more
+    size_t largest_radius = 0;
+    double mean_radius = 0;
+    for (size_t c = 0; c < bank.class_count(); c++) {
+        largest_radius = std::max<size_t>(largest_radius, bank.template_class(c).radius);
+        mean_radius += bank.template_class(c).radius;
     }
-    std::cout << "  Valid templates (128 bytes): " << valid_templates << "/" << templates.size() << std::endl;
+    if (bank.class_count() > 0) mean_radius /= bank.class_count();
+    std::cout << "  Classes (letter, rotation): " << bank.class_count() << ", radius mean "
+              << mean_radius << " max " << largest_radius << std::endl;
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
+#include <array>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <climits>
+#include <memory>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -13,12 +17,54 @@
     #define USE_OPENGL
 #endif
 
+// Packed template geometry: 64x64 pixels, one bit per pixel
+constexpr int TEMPLATE_SIZE = 64;
+constexpr int TEMPLATE_BYTES = TEMPLATE_SIZE * TEMPLATE_SIZE / 8;  // 512
+// Coarse pyramid levels used to shortlist templates before the 64x64 match
+constexpr int PYRAMID_32_BYTES = 32 * 32 / 8;  // 128
+constexpr int PYRAMID_16_BYTES = 16 * 16 / 8;  // 32
+// Largest translation window of the shift-tolerant matcher (+-3 px, 7x7 offsets)
+constexpr int MAX_SHIFT_RADIUS = 3;
+constexpr int MAX_SHIFTED_QUERIES = (2 * MAX_SHIFT_RADIUS + 1) * (2 * MAX_SHIFT_RADIUS + 1);
+
+class TemplateBank;
+
 struct Template {
     char letter;
     int rotation;
     std::vector<uint8_t> bits;
 };
 
+// Per-letter reject thresholds, indexed by (unsigned char) letter
+typedef std::array<int, 256> LetterThresholds;
+
+// A threshold below every distance, so every match is rejected. Calibration
+// returns it when even exact (distance 0) impostors exceed target_far.
+constexpr int REJECT_ALL_THRESHOLD = -1;
+
+// Reject thresholds fitted to labelled validation glyphs (calibrate_threshold)
+struct ThresholdCalibration {
+    struct RocPoint {
+        int threshold;
+        double false_accept_rate;  // Impostor distances <= threshold
+        double false_reject_rate;  // Genuine distances > threshold
+    };
+    double target_far = 0;
+    int threshold = 200;           // Largest threshold within target_far
+                                   // (REJECT_ALL_THRESHOLD if none is)
+    double false_accept_rate = 0;  // At threshold (what it achieves, never above target_far)
+    double false_reject_rate = 0;
+    size_t genuine = 0;            // One per glyph: distance to its own letter
+    size_t impostor = 0;           // One per glyph and other letter: distance to that letter
+    std::vector<RocPoint> roc;     // Every ROC_STEP distances, up to FAR 1
+    // Each letter's threshold for target_far on the impostors matched to
+    // that letter (4096 for letters without templates, REJECT_ALL_THRESHOLD
+    // for letters no threshold keeps within it), and the largest
+    std::shared_ptr<const LetterThresholds> letter_thresholds;
+    int letter_threshold_max = 0;
+    static constexpr int ROC_STEP = 16;
+};
+
 struct RecognitionResult {
     char letter;
     int rotation;
@@ -29,21 +75,140 @@ struct RecognitionResult {
 };
 
 extern std::vector<Template> templates;
+// The settings below are read by every free recognition call without a
+// lock: set them before recognition starts, not while other threads
+// recognize. LETTER_THRESHOLDS is the exception; replace it with
+// std::atomic_store and it is picked up by the next call.
 extern int SAFE_THRESHOLD;
+// Abandon templates as soon as they cannot reach SAFE_THRESHOLD. Faster, but
+// a rejected glyph then reports confidence INT_MAX instead of its distance.
+extern bool EARLY_EXIT_AT_THRESHOLD;
+// Banks with at least this many templates are matched coarse-to-fine
+// (16x16 -> 32x32 -> 64x64 shortlists) instead of exhaustively
+extern size_t COARSE_TO_FINE_MIN_TEMPLATES;
+// Banks averaging at least this many templates per (letter, rotation) class
+// are matched class by class, pruning whole classes on their prototype
+// distance (exact; pays off once classes hold several samples)
+extern size_t CLASS_INDEX_MIN_CLASS_SIZE;
+// Match every template at query offsets of up to +-SHIFT_RADIUS pixels and
+// keep its best distance (absorbs centroid jitter; 0 = exact position only)
+extern int SHIFT_RADIUS;
+// Optional per-letter reject thresholds, applied on top of SAFE_THRESHOLD
+// (null = SAFE_THRESHOLD alone)
+extern std::shared_ptr<const LetterThresholds> LETTER_THRESHOLDS;
 
-// Core functions
+// Core functions. The free recognition functions below use the global bank
+// and settings; see recognizer.h for a reentrant, self-contained Recognizer.
 void load_templates(const std::string& path);
 void load_templates_binary(const std::string& path);
+// Parse a template file without touching the globals (throw std::runtime_error
+// if the file cannot be opened)
+std::vector<Template> read_templates_text(const std::string& path);
+std::vector<Template> read_templates_binary(const std::string& path);
+void save_templates_text(const std::string& path, const std::vector<Template>& list);
+// Letter and rotation from a dataset image name (the stem,
+// <letter>_<rotation>_<n>; only the first character of a longer letter
+// field such as "div" is kept). False if the name does not match.
+bool parse_template_filename(const std::string& stem, char& letter, int& rotation);
+// One template per dataset .jpg (sorted by name), preprocessed exactly
+// like a query. Unparsable names are skipped with a warning; throws
+// std::runtime_error if dir is not a directory.
+std::vector<Template> read_templates_dataset(const std::string& dir, bool upright_only = false);
+// 4096 '0'/'1' characters -> packed 64x64 bitplane (TEMPLATE_BYTES)
+void pack_bit_string(const char* chars, uint8_t* bits);
 char recognize_letter(const cv::Mat& image);  // Legacy function
 RecognitionResult recognize_letter_with_rotation(const cv::Mat& image);  // New function with rotation
-void calibrate_threshold(const std::string& validation_dir);
+// Best K matches (best first) from a single distance pass. Letters are not
+// masked: compare confidence against SAFE_THRESHOLD to reject. Available
+// for K = 1, 2, 3, 5 and 10.
+template<size_t K>
+std::array<RecognitionResult, K> recognize_letter_top_k(const cv::Mat& image);
+// Whole-board recognition: all glyphs matched in one blocked pass over the templates
+std::vector<RecognitionResult> recognize_letters(const std::vector<cv::Mat>& glyphs);
+// Fits the reject threshold to a directory of validation glyphs named like
+// the dataset (<letter>_<rotation>_<n>, searched recursively) against the
+// global bank, sets SAFE_THRESHOLD to it and returns the full calibration.
+// Throws std::runtime_error if the directory holds no usable image.
+ThresholdCalibration calibrate_threshold(const std::string& validation_dir, double target_far = 0.001);
+// The same on packed glyphs (count x TEMPLATE_BYTES) and their letters,
+// against any bank; touches no global. Distances come from the blocked
+// MxN kernel, split across OpenMP threads.
+ThresholdCalibration calibrate_threshold(const TemplateBank& bank, const uint8_t* queries,
+                                         const char* letters, size_t count, double target_far);
+// Text file of threshold, rates, per-letter table and ROC points, kept next
+// to the templates (templates.thresholds). Both throw std::runtime_error.
+void save_threshold_calibration(const std::string& path, const ThresholdCalibration& calibration);
+ThresholdCalibration load_threshold_calibration(const std::string& path);
 
 // Image processing functions
 void adaptive_binarize(const cv::Mat& src, cv::Mat& dst);
+// Centroid-centred 64x64 bitplane of a 64x64 binary (0 / non-zero) image;
+// packed is resized to TEMPLATE_BYTES and fully overwritten
 void center_and_pack(const cv::Mat& bin, std::vector<uint8_t>& packed);
+void center_and_pack_reference(const cv::Mat& bin, std::vector<uint8_t>& packed);
+// Reusable buffers for preprocess_glyph (keep one per thread)
+struct GlyphScratch {
+    cv::Mat resized;
+    cv::Mat binary;
+    std::vector<uint8_t> packed;
+};
+// Resize to 64x64 + adaptive_binarize + center_and_pack; writes TEMPLATE_BYTES to out.
+// preprocess_glyph is the fused single-pass kernel; the reference runs the
+// three functions above and must produce identical bits (test_preprocess.cpp).
+void preprocess_glyph(const cv::Mat& image, GlyphScratch& scratch, uint8_t* out);
+void preprocess_glyph_reference(const cv::Mat& image, GlyphScratch& scratch, uint8_t* out);
 uint16_t hamming_distance(const uint8_t* a, const uint8_t* b);
 
-// Debug functions
+// Hamming kernels, selected once at startup from the CPU features
+// (set LR_HAMMING_KERNEL=<name> to force one)
+typedef uint16_t (*HammingFn)(const uint8_t* a, const uint8_t* b);
+// out[i] = distance(query, bank + i * TEMPLATE_BYTES) for i in [0, count)
+typedef void (*Hamming1xNFn)(const uint8_t* query, const uint8_t* bank, size_t count, uint16_t* out);
+// Exact distance if it is <= bound, otherwise some value > bound
+typedef uint16_t (*HammingBoundedFn)(const uint8_t* a, const uint8_t* b, int bound);
+struct HammingKernel {
+    const char* name;
+    HammingFn distance;
+    Hamming1xNFn distances_1xN;
+    HammingBoundedFn distance_bounded;
+};
+std::vector<HammingKernel> available_hamming_kernels();  // Slowest to fastest
+const HammingKernel& active_hamming_kernel();
+
+// Hamming distance over any multiple of 8 bytes (the coarse pyramid levels)
+uint16_t hamming_distance_bytes(const uint8_t* a, const uint8_t* b, size_t nbytes);
+
+// 2x2 downsampling of a src_size x src_size bitplane (pixel set when at
+// least 2 of its 4 source pixels are), and the 32x32 / 16x16 levels of a
+// packed 64x64 template
+void downsample_bitplane(const uint8_t* src, int src_size, uint8_t* dst);
+void build_pyramid(const uint8_t* bits, uint8_t* level32, uint8_t* level16);
+
+// Quarter turns of a packed 64x64 bitplane, done on its 64 row words (bit
+// matrix transpose, bit reversal, row reversal). degrees is clockwise like
+// the dataset's _90_ / _180_ / _270_ images and must be 0, 90, 180 or 270.
+// src and dst may be the same buffer.
+void transpose_bitplane(const uint8_t* src, uint8_t* dst);
+void rotate_bitplane(const uint8_t* src, int degrees, uint8_t* dst);
+// Moves a packed bitplane's centroid to the centre exactly like
+// center_and_pack. A turned query needs this to line up with templates
+// packed from upright images (mirroring maps centre 32 to 31).
+void center_bitplane(const uint8_t* src, uint8_t* dst);
+// Bitplane moved by (dx, dy) pixels, vacated pixels cleared; dst must not
+// alias src
+void shift_bitplane(const uint8_t* src, int dx, int dy, uint8_t* dst);
+// The query at every offset within +-radius (clamped to MAX_SHIFT_RADIUS),
+// nearest offsets first and (0, 0) at index 0, TEMPLATE_BYTES apart in
+// out (room for MAX_SHIFTED_QUERIES). Returns the number of copies.
+size_t shifted_queries(const uint8_t* query, int radius, uint8_t* out);
+
+// Blocked many-vs-many distances: out[q * out_stride + t] for m queries and
+// n templates, both stored as contiguous TEMPLATE_BYTES-stride matrices
+void hamming_distances_MxN(const uint8_t* queries, size_t m,
+                           const uint8_t* bank, size_t n,
+                           uint16_t* out, size_t out_stride);
+
+// Debug functions (recognition only calls these when tracing, see trace.h)
 void debug_save_image(const cv::Mat& img, const std::string& filename);
 void debug_print_template_stats();
 
@@ -0,0 +1,63 @@
+#include "parallel_recognition.h"
+#include <memory>
+#include <opencv2/imgcodecs.hpp>
+
+// Per-thread buffers, reused by every task that runs on the thread
+struct WorkerScratch {
+    cv::Mat cell;
+    RecognitionContext& recognition = thread_recognition_context();
+};
+
+static WorkerScratch& worker_scratch() {
+    static thread_local WorkerScratch scratch;
+    return scratch;
+}
+
+static RecognitionResult recognize_with_scratch(const Recognizer& recognizer, const cv::Mat& glyph) {
+    return recognizer.recognize(glyph, worker_scratch().recognition);
+}
+
+std::vector<RecognitionResult> recognize_glyphs_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                         const std::vector<cv::Mat>& glyphs) {
+    std::vector<RecognitionResult> results(glyphs.size());
+    parallel_for(pool, 0, glyphs.size(), 1, [&](size_t i) {
+        results[i] = recognize_with_scratch(recognizer, glyphs[i]);
+    });
+    return results;
+}
+
+std::vector<RecognitionResult> recognize_images_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                         const std::vector<std::string>& paths) {
+    std::vector<RecognitionResult> results(paths.size());
+    // A single glyph is cheap to match; decode and match on the same worker
+    parallel_for(pool, 0, paths.size(), 1, [&](size_t i) {
+        cv::Mat image = cv::imread(paths[i]);
+        if (!image.empty()) results[i] = recognize_with_scratch(recognizer, image);
+    });
+    return results;
+}
+
+std::vector<std::vector<RecognitionResult>> recognize_boards_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                                      const BoardExtractor& board,
+                                                                      const std::vector<std::string>& capture_paths) {
+    std::vector<std::vector<RecognitionResult>> results(capture_paths.size());
+    TaskGroup group(pool);
+    for (size_t i = 0; i < capture_paths.size(); i++) {
+        group.run([&, i] {
+            auto capture = std::make_shared<cv::Mat>(cv::imread(capture_paths[i]));
+            if (capture->empty()) return;
+            results[i].resize(board.size());
+            // Cells join the same group, so idle workers steal them while
+            // other captures are still decoding
+            for (size_t c = 0; c < board.size(); c++) {
+                group.run([&, capture, i, c] {
+                    WorkerScratch& scratch = worker_scratch();
+                    board.extract_cell(*capture, c, scratch.cell);
+                    results[i][c] = recognize_with_scratch(recognizer, scratch.cell);
+                });
+            }
+        });
+    }
+    group.wait();
+    return results;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "board_extractor.h"
+#include "recognizer.h"
+#include "thread_pool.h"
+#include <string>
+#include <vector>
+
+// Recognition of many images and board cells on a work-stealing ThreadPool.
+// Decoding, warping, preprocessing and matching run as pool tasks; every
+// worker reuses its own thread-local scratch buffers, so the steady state
+// allocates nothing per glyph beyond what OpenCV does internally.
+
+// One result per in-memory glyph, in order
+std::vector<RecognitionResult> recognize_glyphs_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                         const std::vector<cv::Mat>& glyphs);
+
+// One result per image file, in order. Images that cannot be decoded come
+// back as RecognitionResult() ('?', confidence INT_MAX).
+std::vector<RecognitionResult> recognize_images_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                         const std::vector<std::string>& paths);
+
+// Every cell of every capture: one decode task per capture, then one
+// warp + preprocess + match task per cell, all stealable. results[i] has
+// board.size() entries, or none if capture i could not be decoded.
+std::vector<std::vector<RecognitionResult>> recognize_boards_parallel(ThreadPool& pool, const Recognizer& recognizer,
+                                                                      const BoardExtractor& board,
+                                                                      const std::vector<std::string>& capture_paths);
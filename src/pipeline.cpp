@@ -0,0 +1,124 @@
+#include "pipeline.h"
+#include <algorithm>
+#include <opencv2/imgcodecs.hpp>
+
+RecognitionPipeline::RecognitionPipeline(const Recognizer& recognizer, const BoardExtractor* board,
+                                         PipelineConfig config, Sink sink)
+    : recognizer_(recognizer), board_(board), sink_(std::move(sink)),
+      input_(config.queue_capacity), decoded_(config.queue_capacity),
+      cells_(config.queue_capacity), packed_(config.queue_capacity) {
+    // A stage ends once its input is closed and drained; the last of its
+    // workers then closes the queue feeding the next stage
+    start_stage(config.decode_workers, [this] { decode_worker(); }, [this] { decoded_.close(); });
+    start_stage(config.extract_workers, [this] { extract_worker(); }, [this] { cells_.close(); });
+    start_stage(config.preprocess_workers, [this] { preprocess_worker(); }, [this] { packed_.close(); });
+    start_stage(config.match_workers, [this] { match_worker(); }, nullptr);
+}
+
+RecognitionPipeline::~RecognitionPipeline() {
+    finish();
+}
+
+void RecognitionPipeline::start_stage(size_t count, std::function<void()> body, std::function<void()> done) {
+    count = std::max<size_t>(1, count);
+    running_.push_back(std::make_unique<std::atomic<size_t>>(count));
+    std::atomic<size_t>* running = running_.back().get();
+    for (size_t i = 0; i < count; i++) {
+        workers_.emplace_back([body, done, running] {
+            body();
+            if (running->fetch_sub(1) == 1 && done) done();
+        });
+    }
+}
+
+uint64_t RecognitionPipeline::submit(const std::string& path) {
+    auto frame = std::make_shared<Frame>();
+    frame->result.sequence = next_sequence_++;
+    frame->result.path = path;
+    input_.push(frame);
+    return frame->result.sequence;
+}
+
+uint64_t RecognitionPipeline::submit(const cv::Mat& image) {
+    auto frame = std::make_shared<Frame>();
+    frame->result.sequence = next_sequence_++;
+    frame->image = image;
+    input_.push(frame);
+    return frame->result.sequence;
+}
+
+void RecognitionPipeline::finish() {
+    if (finished_) return;
+    finished_ = true;
+    input_.close();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void RecognitionPipeline::decode_worker() {
+    std::shared_ptr<Frame> frame;
+    while (input_.pop(frame)) {
+        if (frame->image.empty() && !frame->result.path.empty()) {
+            frame->image = cv::imread(frame->result.path);
+        }
+        if (frame->image.empty()) {
+            deliver(std::move(frame));  // Unreadable: report it right away
+            continue;
+        }
+        frame->result.loaded = true;
+        decoded_.push(std::move(frame));
+    }
+}
+
+void RecognitionPipeline::extract_worker() {
+    std::shared_ptr<Frame> frame;
+    while (decoded_.pop(frame)) {
+        size_t count = board_ ? board_->size() : 1;
+        frame->result.cells.resize(count);
+        frame->remaining.store(count);
+        for (size_t c = 0; c < count; c++) {
+            CellItem item;
+            item.frame = frame;
+            item.cell = c;
+            if (board_) {
+                board_->extract_cell(frame->image, c, item.image);
+            } else {
+                item.image = frame->image;
+            }
+            cells_.push(std::move(item));
+        }
+        // Every cell holds its own pixels now; drop the capture early
+        if (board_) frame->image.release();
+        frame.reset();
+    }
+}
+
+void RecognitionPipeline::preprocess_worker() {
+    GlyphScratch scratch;
+    CellItem item;
+    while (cells_.pop(item)) {
+        PackedItem packed;
+        packed.frame = std::move(item.frame);
+        packed.cell = item.cell;
+        preprocess_glyph(item.image, scratch, packed.query.data());
+        item.image.release();
+        packed_.push(std::move(packed));
+    }
+}
+
+void RecognitionPipeline::match_worker() {
+    PackedItem item;
+    while (packed_.pop(item)) {
+        Frame& frame = *item.frame;
+        frame.result.cells[item.cell] = recognizer_.match(item.query.data());
+        // The last cell of a capture hands the whole capture to the sink
+        if (frame.remaining.fetch_sub(1) == 1) deliver(std::move(item.frame));
+        item.frame.reset();
+    }
+}
+
+void RecognitionPipeline::deliver(std::shared_ptr<Frame> frame) {
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    if (sink_) sink_(std::move(frame->result));
+}
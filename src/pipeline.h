@@ -0,0 +1,103 @@
+#pragma once
+#include "board_extractor.h"
+#include "bounded_queue.h"
+#include "recognizer.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Worker threads per stage and the depth of the queues between them
+struct PipelineConfig {
+    size_t decode_workers = 2;      // cv::imread (skipped for submitted frames)
+    size_t extract_workers = 1;     // BoardExtractor warp, one task per cell
+    size_t preprocess_workers = 2;  // adaptive_binarize + center_and_pack
+    size_t match_workers = 2;       // Recognizer::match
+    size_t queue_capacity = 64;     // Items per queue before producers block
+};
+
+// One capture (or single glyph image) through the pipeline
+struct PipelineResult {
+    uint64_t sequence = 0;   // Submission order, starting at 0
+    std::string path;        // Empty for submitted frames
+    bool loaded = false;     // False if the image could not be decoded
+    std::vector<RecognitionResult> cells;  // One per board cell, or one glyph
+};
+
+// Streaming recognition in four stages connected by bounded lock-free
+// queues: decode -> board extraction -> binarize + pack -> match. Every
+// stage has its own worker count, and a full queue blocks its producers,
+// so throughput settles at the slowest stage instead of the sum of all of
+// them and memory stays bounded however fast captures arrive.
+//
+// Results reach the sink in completion order (use `sequence` to reorder);
+// the sink is never called concurrently.
+class RecognitionPipeline {
+public:
+    using Sink = std::function<void(PipelineResult&&)>;
+
+    // board == nullptr: every input is one glyph image. The recognizer and
+    // board must outlive the pipeline.
+    RecognitionPipeline(const Recognizer& recognizer, const BoardExtractor* board,
+                        PipelineConfig config, Sink sink);
+    // Calls finish()
+    ~RecognitionPipeline();
+
+    RecognitionPipeline(const RecognitionPipeline&) = delete;
+    RecognitionPipeline& operator=(const RecognitionPipeline&) = delete;
+
+    // Queue an image file / an already decoded frame; blocks while the
+    // pipeline is full. Returns the sequence number. Safe to call from
+    // several threads, but not concurrently with finish().
+    uint64_t submit(const std::string& path);
+    uint64_t submit(const cv::Mat& frame);
+
+    // No more input: drains every stage and joins the workers
+    void finish();
+
+private:
+    // A capture in flight; shared by all of its cells
+    struct Frame {
+        PipelineResult result;
+        cv::Mat image;
+        std::atomic<size_t> remaining{0};
+    };
+    struct CellItem {
+        std::shared_ptr<Frame> frame;
+        size_t cell = 0;
+        cv::Mat image;
+    };
+    struct PackedItem {
+        std::shared_ptr<Frame> frame;
+        size_t cell = 0;
+        std::array<uint8_t, TEMPLATE_BYTES> query;
+    };
+
+    // Starts `count` workers running `body`; the last one to return calls `done`
+    void start_stage(size_t count, std::function<void()> body, std::function<void()> done);
+
+    void decode_worker();
+    void extract_worker();
+    void preprocess_worker();
+    void match_worker();
+    void deliver(std::shared_ptr<Frame> frame);
+
+    const Recognizer& recognizer_;
+    const BoardExtractor* board_;
+    Sink sink_;
+    std::mutex sink_mutex_;
+
+    BoundedQueue<std::shared_ptr<Frame>> input_;
+    BoundedQueue<std::shared_ptr<Frame>> decoded_;
+    BoundedQueue<CellItem> cells_;
+    BoundedQueue<PackedItem> packed_;
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<std::atomic<size_t>>> running_;  // Live workers per stage
+    std::atomic<uint64_t> next_sequence_{0};
+    bool finished_ = false;
+};
@@ -0,0 +1,129 @@
+#include "recognition_client.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Requests in flight per connection in recognize_tiles: enough to fill a
+// micro-batch, few enough that neither side's socket buffer fills up
+static const size_t PIPELINE_WINDOW = 128;
+
+static void write_all(int fd, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = send(fd, p, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) throw std::runtime_error(std::string("recognized: send failed: ") + std::strerror(errno));
+        p += written;
+        size -= written;
+    }
+}
+
+static void read_all(int fd, void* data, size_t size) {
+    uint8_t* p = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t got = recv(fd, p, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got == 0) throw std::runtime_error("recognized: connection closed by the daemon");
+        if (got < 0) throw std::runtime_error(std::string("recognized: receive failed: ") + std::strerror(errno));
+        p += got;
+        size -= got;
+    }
+}
+
+RecognitionClient::RecognitionClient(const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("recognized: socket path too long: " + socket_path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0 || connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        std::string reason = std::strerror(errno);
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("recognized: could not connect to " + socket_path + ": " + reason);
+    }
+}
+
+RecognitionClient::~RecognitionClient() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void RecognitionClient::send_request(RecognizedKind kind, uint32_t id, size_t top_k, const void* payload,
+                                     size_t size) {
+    if (top_k < 1 || top_k > RECOGNIZED_MAX_TOP_K) throw std::runtime_error("recognized: top_k must be 1 to 10");
+    if (size > RECOGNIZED_MAX_PAYLOAD) throw std::runtime_error("recognized: request too large");
+    RecognizedRequestHeader header;
+    header.id = id;
+    header.kind = kind;
+    header.top_k = static_cast<uint8_t>(top_k);
+    header.payload_size = static_cast<uint32_t>(size);
+    uint8_t bytes[RECOGNIZED_HEADER_BYTES];
+    header.write(bytes);
+    write_all(fd_, bytes, sizeof(bytes));
+    if (size > 0) write_all(fd_, payload, size);
+}
+
+RecognizedReply RecognitionClient::receive_reply(uint32_t& id) {
+    uint8_t bytes[RECOGNIZED_HEADER_BYTES];
+    read_all(fd_, bytes, sizeof(bytes));
+    RecognizedResponseHeader header;
+    if (!header.read(bytes)) throw std::runtime_error("recognized: malformed response");
+    RecognizedReply reply;
+    reply.status = header.status;
+    reply.generation = header.generation;
+    uint8_t match[RECOGNIZED_MATCH_BYTES];
+    for (size_t i = 0; i < header.count; i++) {
+        read_all(fd_, match, sizeof(match));
+        reply.matches.push_back(read_recognized_match(match));
+    }
+    id = header.id;
+    return reply;
+}
+
+RecognizedReply RecognitionClient::call(RecognizedKind kind, size_t top_k, const void* payload, size_t size) {
+    uint32_t id = next_id_++;
+    send_request(kind, id, top_k, payload, size);
+    uint32_t got = 0;
+    RecognizedReply reply = receive_reply(got);
+    if (got != id) throw std::runtime_error("recognized: response for an unknown request");
+    return reply;
+}
+
+RecognizedReply RecognitionClient::recognize_image(const void* data, size_t size, size_t top_k) {
+    return call(RecognizedKind::Image, top_k, data, size);
+}
+
+RecognizedReply RecognitionClient::recognize_tile(const uint8_t* pixels, size_t top_k) {
+    return call(RecognizedKind::Tile, top_k, pixels, RECOGNIZED_TILE_BYTES);
+}
+
+std::vector<RecognizedReply> RecognitionClient::recognize_tiles(const uint8_t* pixels, size_t count, size_t top_k) {
+    std::vector<RecognizedReply> replies(count);
+    const uint32_t first = next_id_;
+    next_id_ += static_cast<uint32_t>(count);
+    size_t sent = 0, received = 0;
+    while (received < count) {
+        if (sent < count && sent - received < PIPELINE_WINDOW) {
+            send_request(RecognizedKind::Tile, first + static_cast<uint32_t>(sent), top_k,
+                         pixels + sent * RECOGNIZED_TILE_BYTES, RECOGNIZED_TILE_BYTES);
+            sent++;
+            continue;
+        }
+        uint32_t id = 0;
+        RecognizedReply reply = receive_reply(id);
+        uint32_t index = id - first;
+        if (index >= sent) throw std::runtime_error("recognized: response for an unknown request");
+        replies[index] = std::move(reply);
+        received++;
+    }
+    return replies;
+}
+
+uint32_t RecognitionClient::reload() {
+    return call(RecognizedKind::Reload, 1, nullptr, 0).generation;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "recognized_protocol.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One reply of the recognized daemon
+struct RecognizedReply {
+    RecognizedStatus status = RecognizedStatus::Ok;
+    uint32_t generation = 0;               // Template bank that answered
+    std::vector<RecognizedMatch> matches;  // Best first; empty unless status is Ok
+};
+
+// Client side of recognized_protocol.h: one connection to the daemon. Needs
+// neither OpenCV nor templates. Not thread-safe; open one per thread (the
+// daemon batches requests across connections). Errors on the connection
+// throw std::runtime_error.
+class RecognitionClient {
+public:
+    explicit RecognitionClient(const std::string& socket_path = RECOGNIZED_DEFAULT_SOCKET);
+    ~RecognitionClient();
+
+    RecognitionClient(const RecognitionClient&) = delete;
+    RecognitionClient& operator=(const RecognitionClient&) = delete;
+
+    // An encoded image file (JPEG, PNG, ...) holding one glyph
+    RecognizedReply recognize_image(const void* data, size_t size, size_t top_k = 1);
+    // A pre-warped 64x64 8-bit gray tile (RECOGNIZED_TILE_BYTES, row-major)
+    RecognizedReply recognize_tile(const uint8_t* pixels, size_t top_k = 1);
+    // count tiles back to back, pipelined on this connection so they can
+    // share the daemon's micro-batches; replies in tile order
+    std::vector<RecognizedReply> recognize_tiles(const uint8_t* pixels, size_t count, size_t top_k = 1);
+    // Asks the daemon to reload its template file; returns the generation
+    // in use when the request was seen (the reload itself is asynchronous)
+    uint32_t reload();
+
+private:
+    void send_request(RecognizedKind kind, uint32_t id, size_t top_k, const void* payload, size_t size);
+    RecognizedReply receive_reply(uint32_t& id);
+    RecognizedReply call(RecognizedKind kind, size_t top_k, const void* payload, size_t size);
+
+    int fd_ = -1;
+    uint32_t next_id_ = 1;
+};
@@ -0,0 +1,328 @@
+#include "recognition_server.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <opencv2/imgcodecs.hpp>
+
+struct RecognitionServer::Connection {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> done{false};
+    std::mutex write_mutex;
+    bool broken = false;  // A send failed: the client is gone, drop its replies
+
+    ~Connection() {
+        if (fd >= 0) close(fd);
+    }
+
+    void send_all(const uint8_t* data, size_t size) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        while (size > 0 && !broken) {
+            ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                broken = true;
+                break;
+            }
+            data += written;
+            size -= written;
+        }
+    }
+};
+
+// False at end of stream or on an error
+static bool read_all(int fd, void* data, size_t size) {
+    uint8_t* p = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t got = recv(fd, p, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+static void append_reply(std::vector<uint8_t>& out, uint32_t id, RecognizedStatus status, uint32_t generation,
+                         const RecognizedMatch* matches, size_t count) {
+    RecognizedResponseHeader header;
+    header.id = id;
+    header.status = status;
+    header.count = static_cast<uint8_t>(count);
+    header.generation = generation;
+    size_t offset = out.size();
+    out.resize(offset + RECOGNIZED_HEADER_BYTES + count * RECOGNIZED_MATCH_BYTES);
+    header.write(out.data() + offset);
+    for (size_t i = 0; i < count; i++) {
+        write_recognized_match(out.data() + offset + RECOGNIZED_HEADER_BYTES + i * RECOGNIZED_MATCH_BYTES, matches[i]);
+    }
+}
+
+static RecognizedMatch to_match(const RecognitionResult& result) {
+    RecognizedMatch match;
+    match.letter = result.letter;
+    match.rotation = result.rotation;
+    match.distance = result.confidence;
+    return match;
+}
+
+// The best k (1-10) matches, unmasked, through the nearest top-K instance
+template<size_t K>
+static size_t copy_top_k(const Recognizer& recognizer, const uint8_t* query, size_t k, RecognizedMatch* out) {
+    std::array<RecognitionResult, K> top = recognizer.match_top_k<K>(query);
+    for (size_t i = 0; i < k; i++) out[i] = to_match(top[i]);
+    return k;
+}
+
+static size_t top_k_matches(const Recognizer& recognizer, const uint8_t* query, size_t k, RecognizedMatch* out) {
+    if (k <= 2) return copy_top_k<2>(recognizer, query, k, out);
+    if (k <= 3) return copy_top_k<3>(recognizer, query, k, out);
+    if (k <= 5) return copy_top_k<5>(recognizer, query, k, out);
+    return copy_top_k<10>(recognizer, query, k, out);
+}
+
+RecognitionServer::RecognitionServer(ReloadableRecognizer& recognizer, RecognitionServerConfig config)
+    : recognizer_(recognizer), config_(std::move(config)) {
+    config_.max_batch = std::max<size_t>(config_.max_batch, 1);
+    config_.max_wait_us = std::max(config_.max_wait_us, 0);
+    config_.batch_threads = std::max<size_t>(config_.batch_threads, 1);
+}
+
+RecognitionServer::~RecognitionServer() {
+    stop();
+}
+
+void RecognitionServer::start() {
+    const std::string& path = config_.socket_path;
+    sockaddr_un address{};
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket file left by a daemon that died is replaced; one that still
+    // answers belongs to a running daemon
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) throw std::runtime_error("Not a socket: " + path);
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) throw std::runtime_error("Another daemon is serving " + path);
+        unlink(path.c_str());
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0 || pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        std::string reason = std::strerror(errno);
+        if (listen_fd_ >= 0) close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Could not listen on " + path + ": " + reason);
+    }
+
+    stopping_ = false;
+    for (size_t i = 0; i < config_.batch_threads; i++) {
+        batchers_.emplace_back(&RecognitionServer::batch_loop, this);
+    }
+    acceptor_ = std::thread(&RecognitionServer::accept_loop, this);
+}
+
+void RecognitionServer::stop() {
+    if (!acceptor_.joinable()) return;
+    char byte = 1;
+    ssize_t written = write(wake_fds_[1], &byte, 1);
+    (void)written;
+    acceptor_.join();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(config_.socket_path.c_str());
+
+    // Readers see end of stream; replies to what they queued can still go out
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (auto& connection : connections_) shutdown(connection->fd, SHUT_RD);
+        for (auto& connection : connections_) connection->thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    for (std::thread& batcher : batchers_) batcher.join();
+    batchers_.clear();
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections_.clear();
+    }
+    for (int& fd : wake_fds_) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+RecognitionServer::Stats RecognitionServer::stats() const {
+    Stats stats;
+    stats.connections = connection_count_.load();
+    stats.requests = request_count_.load();
+    stats.batches = batch_count_.load();
+    stats.batched_glyphs = batched_glyph_count_.load();
+    return stats;
+}
+
+void RecognitionServer::accept_loop() {
+    pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+    for (;;) {
+        int ready = poll(fds, 2, -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0 || (fds[1].revents & POLLIN)) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        connection_count_++;
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        // Join the threads of connections that have closed
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if ((*it)->done.load()) {
+                (*it)->thread.join();
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        connection->thread = std::thread(&RecognitionServer::serve, this, connection);
+        connections_.push_back(std::move(connection));
+    }
+}
+
+void RecognitionServer::serve(std::shared_ptr<Connection> connection) {
+    GlyphScratch& scratch = thread_recognition_context().glyph;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> reply;
+    uint8_t bytes[RECOGNIZED_HEADER_BYTES];
+    RecognizedRequestHeader request;
+    // A bad magic or an oversized payload means the stream cannot be
+    // trusted any more: the connection is closed
+    while (read_all(connection->fd, bytes, sizeof(bytes)) && request.read(bytes) &&
+           request.payload_size <= RECOGNIZED_MAX_PAYLOAD) {
+        payload.resize(request.payload_size);
+        if (!read_all(connection->fd, payload.data(), payload.size())) break;
+        request_count_++;
+
+        Pending pending;
+        RecognizedStatus status = RecognizedStatus::Ok;
+        bool glyph = request.kind == RecognizedKind::Tile || request.kind == RecognizedKind::Image;
+        if (request.kind == RecognizedKind::Reload) {
+            recognizer_.request_reload();
+        } else if (!glyph || request.top_k < 1 || request.top_k > RECOGNIZED_MAX_TOP_K ||
+                   (request.kind == RecognizedKind::Tile && payload.size() != RECOGNIZED_TILE_BYTES)) {
+            status = RecognizedStatus::BadRequest;
+        } else if (request.kind == RecognizedKind::Tile) {
+            cv::Mat tile(RECOGNIZED_TILE_SIZE, RECOGNIZED_TILE_SIZE, CV_8UC1, payload.data());
+            preprocess_glyph(tile, scratch, pending.query);
+        } else {
+            cv::Mat image = cv::imdecode(payload, cv::IMREAD_COLOR);
+            if (image.empty()) {
+                status = RecognizedStatus::DecodeFailed;
+            } else {
+                preprocess_glyph(image, scratch, pending.query);
+            }
+        }
+        if (!glyph || status != RecognizedStatus::Ok) {
+            reply.clear();
+            append_reply(reply, request.id, status, static_cast<uint32_t>(recognizer_.generation()), nullptr, 0);
+            connection->send_all(reply.data(), reply.size());
+            continue;
+        }
+
+        pending.connection = connection;
+        pending.id = request.id;
+        pending.top_k = request.top_k;
+        pending.arrived = std::chrono::steady_clock::now();
+        size_t queued;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back(std::move(pending));
+            queued = queue_.size();
+        }
+        // The first glyph starts a batch; a full batch is cut right away
+        if (queued == 1) queue_cv_.notify_one();
+        if (queued >= config_.max_batch) queue_cv_.notify_all();
+    }
+    connection->done = true;
+}
+
+void RecognitionServer::batch_loop() {
+    RecognitionContext context;
+    std::vector<Pending> batch;
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    for (;;) {
+        queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;  // Stopping, and everything is answered
+        auto due = queue_.front().arrived + std::chrono::microseconds(config_.max_wait_us);
+        queue_cv_.wait_until(lock, due, [this] { return stopping_ || queue_.size() >= config_.max_batch; });
+        size_t take = std::min(queue_.size(), config_.max_batch);
+        if (take == 0) continue;  // Another batcher took them
+        batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + take));
+        queue_.erase(queue_.begin(), queue_.begin() + take);
+        lock.unlock();
+        run_batch(batch, context);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void RecognitionServer::run_batch(std::vector<Pending>& batch, RecognitionContext& context) {
+    // One load: the generation in the replies is the bank that matched them
+    ReloadableRecognizer::VersionedSnapshot snapshot = recognizer_.versioned_snapshot();
+    const Recognizer* recognizer = snapshot.recognizer.get();
+    const uint32_t generation = static_cast<uint32_t>(snapshot.generation);
+    batch_count_++;
+    batched_glyph_count_ += batch.size();
+
+    // Top-1 requests (the usual case) share one match_all pass; longer
+    // lists are matched one by one. Both use match()'s strategy, so a top-1
+    // reply agrees with the head of a top-k one
+    thread_local std::vector<uint8_t> queries;
+    thread_local std::vector<RecognitionResult> best;
+    thread_local std::vector<uint8_t> replies;
+    queries.clear();
+    for (const Pending& pending : batch) {
+        if (pending.top_k == 1) queries.insert(queries.end(), pending.query, pending.query + TEMPLATE_BYTES);
+    }
+    best.resize(queries.size() / TEMPLATE_BYTES);
+    recognizer->match_all(queries.data(), best.size(), context, best.data());
+
+    // Replies to one connection are coalesced into one write per run
+    replies.clear();
+    size_t next_best = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        const Pending& pending = batch[i];
+        RecognizedMatch matches[RECOGNIZED_MAX_TOP_K];
+        size_t count = 1;
+        if (pending.top_k == 1) {
+            matches[0] = to_match(best[next_best++]);
+        } else {
+            count = top_k_matches(*recognizer, pending.query, pending.top_k, matches);
+        }
+        append_reply(replies, pending.id, RecognizedStatus::Ok, generation, matches, count);
+        if (i + 1 == batch.size() || batch[i + 1].connection != pending.connection) {
+            pending.connection->send_all(replies.data(), replies.size());
+            replies.clear();
+        }
+    }
+}
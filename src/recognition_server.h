@@ -0,0 +1,84 @@
+#pragma once
+#include "recognized_protocol.h"
+#include "reloadable_recognizer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RecognitionServerConfig {
+    std::string socket_path = RECOGNIZED_DEFAULT_SOCKET;
+    size_t max_batch = 64;     // Glyphs per micro-batch
+    int max_wait_us = 200;     // Longest the first glyph of a batch waits for more
+    size_t batch_threads = 2;  // Threads matching micro-batches
+};
+
+// The recognized daemon without its command line: serves
+// recognized_protocol.h on a Unix socket. Each connection has a thread that
+// reads requests and decodes + packs their glyphs; packed glyphs from all
+// connections are queued and matched in micro-batches with one blocked
+// M x N pass (Recognizer::match_all). A batch is cut when it holds
+// max_batch glyphs or its first glyph has waited max_wait_us. Every batch
+// matches against one snapshot of the ReloadableRecognizer, so reloads
+// never stall or split a batch.
+class RecognitionServer {
+public:
+    struct Stats {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        uint64_t batched_glyphs = 0;  // Over batches: the mean batch size
+    };
+
+    RecognitionServer(ReloadableRecognizer& recognizer, RecognitionServerConfig config = RecognitionServerConfig());
+    ~RecognitionServer();
+
+    RecognitionServer(const RecognitionServer&) = delete;
+    RecognitionServer& operator=(const RecognitionServer&) = delete;
+
+    // Binds and listens (replacing a stale socket file, refusing one a live
+    // daemon answers on) and starts serving. Throws std::runtime_error.
+    void start();
+    // Closes the socket and every connection, answers what is already
+    // queued, and joins all threads (also done by the destructor)
+    void stop();
+    Stats stats() const;
+
+private:
+    struct Connection;
+    struct Pending {
+        alignas(64) uint8_t query[TEMPLATE_BYTES];
+        std::shared_ptr<Connection> connection;
+        uint32_t id = 0;
+        uint8_t top_k = 1;
+        std::chrono::steady_clock::time_point arrived;
+    };
+
+    void accept_loop();
+    void serve(std::shared_ptr<Connection> connection);
+    void batch_loop();
+    void run_batch(std::vector<Pending>& batch, RecognitionContext& context);
+
+    ReloadableRecognizer& recognizer_;
+    RecognitionServerConfig config_;
+    int listen_fd_ = -1;
+    int wake_fds_[2] = {-1, -1};  // Self-pipe that interrupts accept's poll()
+    std::thread acceptor_;
+    std::vector<std::thread> batchers_;
+
+    std::mutex connections_mutex_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Pending> queue_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> connection_count_{0}, request_count_{0}, batch_count_{0}, batched_glyph_count_{0};
+};
@@ -1,4 +1,7 @@
 #include "letter_recognition.h"
+#include "board_extractor.h"
+#include "template_bank.h"
+#include "trace.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -9,19 +12,26 @@
 
 int main(int argc, char** argv) {
     // Check command line arguments
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <image_path>" << std::endl;
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <image_path> [coords.csv]" << std::endl;
         std::cerr << "Example: " << argv[0] << " test_images/test01.jpg" << std::endl;
+        std::cerr << "With coords.csv, image_path is a whole board capture and every cell is recognized" << std::endl;
         return 1;
     }
     
     std::string image_path = argv[1];
     
-    // Load templates
-    load_templates_binary("templates.bin");
+    // Load templates (the mapped bank when template_generator wrote one)
+    if (TemplateBank::is_bank_file("templates.bank")) {
+        load_template_bank("templates.bank");
+    } else {
+        load_templates_binary("templates.bin");
+    }
     
-    // Debug: Print template statistics
-    debug_print_template_stats();
+    // Debug: Print template statistics (LR_TRACE=text or higher)
+    if (trace_level() >= TraceLevel::Text) {
+        debug_print_template_stats();
+    }
     
     // Load test image
     cv::Mat image = cv::imread(image_path);
@@ -30,6 +40,30 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    // Board mode: warp every cell of the capture in memory and match them together
+    if (argc == 3) {
+        BoardExtractor board;
+        try {
+            board = BoardExtractor(argv[2]);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        
+        std::vector<RecognitionResult> results = recognize_letters(board.extract(image));
+        
+        std::cout << "\n=== Board Recognition Results ===" << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            std::cout << board.place(i) << " " << results[i].letter << " " << results[i].rotation
+                      << "° " << results[i].confidence << std::endl;
+        }
+        
+        if (trace_level() >= TraceLevel::Counters) {
+            print_trace_counters(std::cout);
+        }
+        return 0;
+    }
+    
     // Recognize letter with rotation
     RecognitionResult result = recognize_letter_with_rotation(image);
     
@@ -45,5 +79,9 @@ int main(int argc, char** argv) {
         std::cout << "✗ Letter not recognized (confidence too low)" << std::endl;
     }
     
+    if (trace_level() >= TraceLevel::Counters) {
+        print_trace_counters(std::cout);
+    }
+    
     return 0;
 }
\ No newline at end of file
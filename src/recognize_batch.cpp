@@ -0,0 +1,410 @@
+#include "pipeline.h"
+#include "recognizer.h"
+#include "template_bank.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <opencv2/imgcodecs.hpp>
+
+// Recognizes many images in one process: templates are loaded once and the
+// images are decoded and matched on a work-stealing thread pool. Results come
+// out in input order, one line per image.
+
+namespace fs = std::filesystem;
+
+enum class OutputFormat { Csv, Jsonl };
+
+struct BatchOptions {
+    std::string templates_path;
+    std::string output_path;
+    OutputFormat format = OutputFormat::Csv;
+    int threads = 0;        // 0 = all hardware threads
+    bool pin_threads = false;
+    size_t top_k = 1;
+    int threshold = -1;     // -1 = SAFE_THRESHOLD
+    std::string thresholds_path;  // Calibration file (default: next to the templates)
+    int shift_radius = -1;  // -1 = SHIFT_RADIUS
+    std::string board_path; // coords.csv: inputs are board captures
+    PipelineConfig stages;
+    std::vector<std::string> inputs;
+};
+
+struct BatchResult {
+    bool loaded = false;
+    RecognitionResult best;                  // Thresholded ('?' when rejected)
+    std::vector<RecognitionResult> top;      // Unmasked best-first matches
+};
+
+static const size_t SUPPORTED_TOP_K[] = {1, 2, 3, 5, 10};
+
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <image|directory|@manifest>..." << std::endl;
+    std::cerr << "  A directory is searched recursively for images; a manifest lists one path per line" << std::endl;
+    std::cerr << "  (blank lines and lines starting with # are ignored)." << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --templates PATH   templates.bank / .bin / .txt (default: templates.bank, else templates.bin)" << std::endl;
+    std::cerr << "  --threads N        worker threads (default: all cores)" << std::endl;
+    std::cerr << "  --pin              pin worker threads to CPUs" << std::endl;
+    std::cerr << "  --format csv|jsonl output format (default: csv)" << std::endl;
+    std::cerr << "  --top-k K          matches reported per image: 1, 2, 3, 5 or 10 (default: 1)" << std::endl;
+    std::cerr << "  --threshold N      reject above this distance (default: " << SAFE_THRESHOLD << ")" << std::endl;
+    std::cerr << "  --thresholds FILE  calibrated global + per-letter thresholds (default: the templates'" << std::endl;
+    std::cerr << "                     .thresholds file, if present and --threshold is not given)" << std::endl;
+    std::cerr << "  --shift-radius N   also match at offsets of up to N pixels, 0-" << MAX_SHIFT_RADIUS
+              << " (default: " << SHIFT_RADIUS << ")" << std::endl;
+    std::cerr << "  --output FILE      write results to FILE instead of stdout" << std::endl;
+    std::cerr << "  --board FILE       inputs are board captures cut into cells by FILE (coords.csv);" << std::endl;
+    std::cerr << "                     they stream through the decode/extract/binarize/match pipeline" << std::endl;
+    std::cerr << "  --stages D,E,P,M   pipeline workers per stage (default: 2,1,2,2)" << std::endl;
+}
+
+static bool is_image_file(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tif" || ext == ".tiff";
+}
+
+// Expands directories and manifests into image paths (directories sorted)
+static bool collect_inputs(const std::vector<std::string>& inputs, std::vector<std::string>& paths) {
+    for (const std::string& input : inputs) {
+        if (!input.empty() && input[0] == '@') {
+            std::ifstream manifest(input.substr(1));
+            if (!manifest.is_open()) {
+                std::cerr << "Error: Could not open manifest " << input.substr(1) << std::endl;
+                return false;
+            }
+            std::string line;
+            while (std::getline(manifest, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.empty() || line[0] == '#') continue;
+                paths.push_back(line);
+            }
+        } else if (fs::is_directory(input)) {
+            std::vector<std::string> found;
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && is_image_file(entry.path())) {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        } else {
+            paths.push_back(input);
+        }
+    }
+    return true;
+}
+
+static bool parse_args(int argc, char** argv, BatchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--templates" && has_value) {
+            options.templates_path = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            options.output_path = argv[++i];
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--threshold" && has_value) {
+            options.threshold = std::atoi(argv[++i]);
+        } else if (arg == "--thresholds" && has_value) {
+            options.thresholds_path = argv[++i];
+        } else if (arg == "--shift-radius" && has_value) {
+            options.shift_radius = std::atoi(argv[++i]);
+            if (options.shift_radius < 0 || options.shift_radius > MAX_SHIFT_RADIUS) {
+                std::cerr << "Error: --shift-radius must be 0 to " << MAX_SHIFT_RADIUS << std::endl;
+                return false;
+            }
+        } else if (arg == "--top-k" && has_value) {
+            options.top_k = std::strtoul(argv[++i], nullptr, 10);
+            if (std::find(std::begin(SUPPORTED_TOP_K), std::end(SUPPORTED_TOP_K), options.top_k) == std::end(SUPPORTED_TOP_K)) {
+                std::cerr << "Error: --top-k must be 1, 2, 3, 5 or 10" << std::endl;
+                return false;
+            }
+        } else if (arg == "--format" && has_value) {
+            std::string format = argv[++i];
+            if (format == "csv") {
+                options.format = OutputFormat::Csv;
+            } else if (format == "jsonl") {
+                options.format = OutputFormat::Jsonl;
+            } else {
+                std::cerr << "Error: Unknown format " << format << std::endl;
+                return false;
+            }
+        } else if (arg == "--board" && has_value) {
+            options.board_path = argv[++i];
+        } else if (arg == "--stages" && has_value) {
+            size_t* counts[] = {&options.stages.decode_workers, &options.stages.extract_workers,
+                                &options.stages.preprocess_workers, &options.stages.match_workers};
+            std::string spec = argv[++i];
+            size_t start = 0;
+            for (size_t s = 0; s < 4; s++) {
+                size_t comma = spec.find(',', start);
+                *counts[s] = std::strtoul(spec.substr(start, comma - start).c_str(), nullptr, 10);
+                if (comma == std::string::npos) break;
+                start = comma + 1;
+            }
+        } else if (arg == "--pin") {
+            options.pin_threads = true;
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') {
+            std::cerr << "Error: Unknown or incomplete option " << arg << std::endl;
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+template<size_t K>
+static void top_k_into(const Recognizer& recognizer, const cv::Mat& image, std::vector<RecognitionResult>& out) {
+    std::array<RecognitionResult, K> top = recognizer.recognize_top_k<K>(image);
+    out.assign(top.begin(), top.end());
+}
+
+static void recognize_one(const Recognizer& recognizer, const cv::Mat& image, size_t k, BatchResult& result) {
+    switch (k) {
+        case 1: top_k_into<1>(recognizer, image, result.top); break;
+        case 2: top_k_into<2>(recognizer, image, result.top); break;
+        case 3: top_k_into<3>(recognizer, image, result.top); break;
+        case 5: top_k_into<5>(recognizer, image, result.top); break;
+        default: top_k_into<10>(recognizer, image, result.top); break;
+    }
+    // Drop slots the bank was too small to fill
+    while (!result.top.empty() && result.top.back().confidence == INT_MAX) result.top.pop_back();
+
+    result.best = result.top.empty() ? RecognitionResult() : result.top.front();
+    if (recognizer.rejects(result.best)) {
+        result.best.letter = '?';
+        result.best.rotation = 0;
+    }
+}
+
+static std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static void write_result(std::ostream& out, OutputFormat format, const std::string& path, const BatchResult& r) {
+    if (format == OutputFormat::Csv) {
+        out << csv_field(path) << ',';
+        if (!r.loaded) {
+            out << "?,,,,unreadable\n";
+            return;
+        }
+        out << r.best.letter << ',' << r.best.rotation << ',' << r.top.front().confidence << ',';
+        // top_k: letter:rotation:distance entries separated by ';'
+        for (size_t i = 0; i < r.top.size(); i++) {
+            if (i) out << ';';
+            out << r.top[i].letter << ':' << r.top[i].rotation << ':' << r.top[i].confidence;
+        }
+        out << ",ok\n";
+    } else {
+        out << "{\"path\":" << json_string(path);
+        if (!r.loaded) {
+            out << ",\"status\":\"unreadable\"}\n";
+            return;
+        }
+        out << ",\"status\":\"ok\",\"letter\":" << json_string(std::string(1, r.best.letter))
+            << ",\"rotation\":" << r.best.rotation << ",\"distance\":" << r.top.front().confidence
+            << ",\"top_k\":[";
+        for (size_t i = 0; i < r.top.size(); i++) {
+            if (i) out << ',';
+            out << "{\"letter\":" << json_string(std::string(1, r.top[i].letter))
+                << ",\"rotation\":" << r.top[i].rotation << ",\"distance\":" << r.top[i].confidence << '}';
+        }
+        out << "]}\n";
+    }
+}
+
+static void write_board_result(std::ostream& out, OutputFormat format, const BoardExtractor& board,
+                               const PipelineResult& r) {
+    if (format == OutputFormat::Csv) {
+        if (!r.loaded) {
+            out << csv_field(r.path) << ",,?,,,unreadable\n";
+            return;
+        }
+        for (size_t c = 0; c < r.cells.size(); c++) {
+            out << csv_field(r.path) << ',' << csv_field(board.place(c)) << ',' << r.cells[c].letter << ','
+                << r.cells[c].rotation << ',' << r.cells[c].confidence << ",ok\n";
+        }
+    } else {
+        out << "{\"path\":" << json_string(r.path);
+        if (!r.loaded) {
+            out << ",\"status\":\"unreadable\"}\n";
+            return;
+        }
+        out << ",\"status\":\"ok\",\"cells\":[";
+        for (size_t c = 0; c < r.cells.size(); c++) {
+            if (c) out << ',';
+            out << "{\"place\":" << json_string(board.place(c))
+                << ",\"letter\":" << json_string(std::string(1, r.cells[c].letter))
+                << ",\"rotation\":" << r.cells[c].rotation << ",\"distance\":" << r.cells[c].confidence << '}';
+        }
+        out << "]}\n";
+    }
+}
+
+// Board captures: decode -> extract -> binarize -> match as a staged
+// pipeline, one record per cell, captures in input order
+static int run_board_pipeline(const BatchOptions& options, const Recognizer& recognizer,
+                              const std::vector<std::string>& paths, std::ostream& out) {
+    BoardExtractor board;
+    try {
+        board = BoardExtractor(options.board_path);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PipelineResult> results(paths.size());
+    {
+        RecognitionPipeline pipeline(recognizer, &board, options.stages, [&](PipelineResult&& r) {
+            results[r.sequence] = std::move(r);
+        });
+        for (const std::string& path : paths) {
+            pipeline.submit(path);
+        }
+        pipeline.finish();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.format == OutputFormat::Csv) out << "path,place,letter,rotation,distance,status\n";
+    size_t unreadable = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!results[i].loaded) {
+            std::cerr << "Warning: Could not load image " << paths[i] << std::endl;
+            unreadable++;
+        }
+        write_board_result(out, options.format, board, results[i]);
+    }
+    out.flush();
+
+    std::cerr << "Recognized " << paths.size() - unreadable << "/" << paths.size() << " captures ("
+              << (paths.size() - unreadable) * board.size() << " cells) in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0 ? paths.size() / seconds : 0.0) << " captures/s)" << std::endl;
+    if (trace_level() >= TraceLevel::Counters) {
+        print_trace_counters(std::cerr);
+    }
+    return unreadable ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    if (!collect_inputs(options.inputs, paths)) return 1;
+
+    // Load templates once for the whole batch
+    if (options.templates_path.empty()) {
+        options.templates_path = TemplateBank::is_bank_file("templates.bank") ? "templates.bank" : "templates.bin";
+    }
+    RecognizerConfig config;
+    config.threshold = options.threshold >= 0 ? options.threshold : SAFE_THRESHOLD;
+    config.shift_radius = options.shift_radius >= 0 ? options.shift_radius : SHIFT_RADIUS;
+    std::string thresholds_path = options.thresholds_path;
+    if (thresholds_path.empty() && options.threshold < 0) {
+        std::string sibling = fs::path(options.templates_path).replace_extension(".thresholds").string();
+        if (fs::exists(sibling)) thresholds_path = sibling;
+    }
+    Recognizer recognizer;
+    try {
+        if (!thresholds_path.empty()) {
+            use_threshold_calibration(config, load_threshold_calibration(thresholds_path));
+            std::cerr << "Using thresholds from " << thresholds_path << " (up to " << config.threshold << ")" << std::endl;
+        }
+        recognizer = Recognizer::from_file(options.templates_path, config);
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading templates: " << e.what() << std::endl;
+        return 1;
+    }
+    if (recognizer.bank().empty()) {
+        std::cerr << "Error: No templates in " << options.templates_path << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!options.output_path.empty()) {
+        file.open(options.output_path);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not write " << options.output_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.output_path.empty() ? std::cout : file;
+
+    if (!options.board_path.empty()) {
+        return run_board_pipeline(options, recognizer, paths, out);
+    }
+
+    ThreadPool pool(options.threads > 0 ? options.threads : 0, options.pin_threads);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Decode + match per image; idle workers steal, which evens out decode times
+    std::vector<BatchResult> results(paths.size());
+    parallel_for(pool, 0, paths.size(), 1, [&](size_t i) {
+        cv::Mat image = cv::imread(paths[i]);
+        if (image.empty()) return;
+        results[i].loaded = true;
+        recognize_one(recognizer, image, options.top_k, results[i]);
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.format == OutputFormat::Csv) out << "path,letter,rotation,distance,top_k,status\n";
+    size_t unreadable = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!results[i].loaded) {
+            std::cerr << "Warning: Could not load image " << paths[i] << std::endl;
+            unreadable++;
+        }
+        write_result(out, options.format, paths[i], results[i]);
+    }
+    out.flush();
+
+    std::cerr << "Recognized " << paths.size() - unreadable << "/" << paths.size() << " images in "
+              << seconds * 1000.0 << " ms (" << (seconds > 0 ? paths.size() / seconds : 0.0)
+              << " images/s, " << pool.size() << " threads)" << std::endl;
+    if (trace_level() >= TraceLevel::Counters) {
+        print_trace_counters(std::cerr);
+    }
+
+    return unreadable ? 2 : 0;
+}
@@ -0,0 +1,150 @@
+#include "recognition_client.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Command line client of the recognized daemon: sends image files (or,
+// with --tiles, 64x64 gray tiles cut from them here) and prints one CSV
+// line per file, in the columns recognize_batch uses.
+
+struct ClientOptions {
+    std::string socket_path = RECOGNIZED_DEFAULT_SOCKET;
+    size_t top_k = 1;
+    bool tiles = false;
+    bool reload = false;
+    std::vector<std::string> inputs;
+};
+
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <image>..." << std::endl;
+    std::cerr << "  --socket PATH   daemon socket (default: " << RECOGNIZED_DEFAULT_SOCKET << ")" << std::endl;
+    std::cerr << "  --top-k K       matches per image, 1-10 (default: 1; above 1 the list is not" << std::endl;
+    std::cerr << "                  masked by the threshold)" << std::endl;
+    std::cerr << "  --tiles         resize to 64x64 gray here and send all images pipelined as tiles" << std::endl;
+    std::cerr << "  --reload        ask the daemon to reload its templates (no images needed)" << std::endl;
+}
+
+static bool parse_args(int argc, char** argv, ClientOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) {
+            options.socket_path = argv[++i];
+        } else if (arg == "--top-k" && has_value) {
+            options.top_k = std::strtoul(argv[++i], nullptr, 10);
+            if (options.top_k < 1 || options.top_k > RECOGNIZED_MAX_TOP_K) {
+                std::cerr << "Error: --top-k must be 1 to " << RECOGNIZED_MAX_TOP_K << std::endl;
+                return false;
+            }
+        } else if (arg == "--tiles") {
+            options.tiles = true;
+        } else if (arg == "--reload") {
+            options.reload = true;
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') {
+            std::cerr << "Error: Unknown or incomplete option " << arg << std::endl;
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return options.reload || !options.inputs.empty();
+}
+
+static const char* status_name(RecognizedStatus status) {
+    switch (status) {
+        case RecognizedStatus::Ok: return "ok";
+        case RecognizedStatus::BadRequest: return "bad_request";
+        case RecognizedStatus::DecodeFailed: return "decode_failed";
+    }
+    return "error";
+}
+
+static void write_reply(std::ostream& out, const std::string& path, const RecognizedReply& reply) {
+    out << path << ',';
+    if (reply.status != RecognizedStatus::Ok || reply.matches.empty()) {
+        out << "?,,,," << status_name(reply.status) << '\n';
+        return;
+    }
+    const RecognizedMatch& best = reply.matches.front();
+    out << best.letter << ',' << best.rotation << ',' << best.distance << ',';
+    for (size_t i = 0; i < reply.matches.size(); i++) {
+        if (i) out << ';';
+        out << reply.matches[i].letter << ':' << reply.matches[i].rotation << ':' << reply.matches[i].distance;
+    }
+    out << ",ok\n";
+}
+
+int main(int argc, char** argv) {
+    ClientOptions options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        RecognitionClient client(options.socket_path);
+        if (options.reload) {
+            std::cerr << "Reload requested (templates at generation " << client.reload() << ")" << std::endl;
+        }
+        if (options.inputs.empty()) return 0;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<RecognizedReply> replies(options.inputs.size());
+        std::vector<bool> readable(options.inputs.size(), false);
+        if (options.tiles) {
+            std::vector<uint8_t> pixels;
+            std::vector<size_t> sent;
+            for (size_t i = 0; i < options.inputs.size(); i++) {
+                cv::Mat image = cv::imread(options.inputs[i], cv::IMREAD_GRAYSCALE);
+                if (image.empty()) continue;
+                cv::Mat tile(RECOGNIZED_TILE_SIZE, RECOGNIZED_TILE_SIZE, CV_8UC1);
+                cv::resize(image, tile, tile.size());
+                for (int y = 0; y < tile.rows; y++) {
+                    pixels.insert(pixels.end(), tile.ptr<uint8_t>(y), tile.ptr<uint8_t>(y) + tile.cols);
+                }
+                sent.push_back(i);
+            }
+            std::vector<RecognizedReply> tile_replies = client.recognize_tiles(pixels.data(), sent.size(), options.top_k);
+            for (size_t t = 0; t < sent.size(); t++) {
+                replies[sent[t]] = std::move(tile_replies[t]);
+                readable[sent[t]] = true;
+            }
+        } else {
+            for (size_t i = 0; i < options.inputs.size(); i++) {
+                std::ifstream file(options.inputs[i], std::ios::binary);
+                if (!file.is_open()) continue;
+                std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                replies[i] = client.recognize_image(bytes.data(), bytes.size(), options.top_k);
+                readable[i] = true;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "path,letter,rotation,distance,top_k,status\n";
+        size_t unreadable = 0;
+        for (size_t i = 0; i < options.inputs.size(); i++) {
+            if (!readable[i]) {
+                std::cerr << "Warning: Could not load image " << options.inputs[i] << std::endl;
+                std::cout << options.inputs[i] << ",?,,,,unreadable\n";
+                unreadable++;
+                continue;
+            }
+            write_reply(std::cout, options.inputs[i], replies[i]);
+            if (replies[i].status != RecognizedStatus::Ok) unreadable++;
+        }
+        std::cout.flush();
+        std::cerr << "Recognized " << options.inputs.size() - unreadable << "/" << options.inputs.size()
+                  << " images in " << seconds * 1000.0 << " ms ("
+                  << seconds * 1e6 / options.inputs.size() << " us per image)" << std::endl;
+        return unreadable ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
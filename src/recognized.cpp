@@ -0,0 +1,159 @@
+#include "recognition_server.h"
+#include "reloadable_recognizer.h"
+#include "template_bank.h"
+#include "trace.h"
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+
+// Recognition daemon: loads the templates once and answers glyph requests
+// from other processes over a Unix socket (recognized_protocol.h), batching
+// concurrent requests for the M x N kernel. SIGHUP or a Reload request
+// reloads the templates; SIGINT / SIGTERM shut it down.
+
+namespace fs = std::filesystem;
+
+struct DaemonOptions {
+    std::string templates_path;
+    int threshold = -1;           // -1 = SAFE_THRESHOLD
+    std::string thresholds_path;  // Calibration file (default: next to the templates)
+    int shift_radius = -1;        // -1 = SHIFT_RADIUS
+    bool watch = false;
+    RecognitionServerConfig server;
+};
+
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "  --socket PATH      Unix socket to serve (default: " << RECOGNIZED_DEFAULT_SOCKET << ")" << std::endl;
+    std::cerr << "  --templates PATH   templates.bank / .bin / .txt (default: templates.bank, else templates.bin)" << std::endl;
+    std::cerr << "  --threshold N      reject above this distance (default: " << SAFE_THRESHOLD << ")" << std::endl;
+    std::cerr << "  --thresholds FILE  calibrated global + per-letter thresholds (default: the templates'" << std::endl;
+    std::cerr << "                     .thresholds file, if present and --threshold is not given)" << std::endl;
+    std::cerr << "  --shift-radius N   also match at offsets of up to N pixels, 0-" << MAX_SHIFT_RADIUS
+              << " (default: " << SHIFT_RADIUS << ")" << std::endl;
+    std::cerr << "  --max-batch N      glyphs per micro-batch (default: 64)" << std::endl;
+    std::cerr << "  --max-wait-us N    longest a glyph waits for its batch to fill (default: 200)" << std::endl;
+    std::cerr << "  --batch-threads N  threads matching batches (default: 2)" << std::endl;
+    std::cerr << "  --watch            reload when the template file is replaced" << std::endl;
+}
+
+static bool parse_args(int argc, char** argv, DaemonOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) {
+            options.server.socket_path = argv[++i];
+        } else if (arg == "--templates" && has_value) {
+            options.templates_path = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            options.threshold = std::atoi(argv[++i]);
+        } else if (arg == "--thresholds" && has_value) {
+            options.thresholds_path = argv[++i];
+        } else if (arg == "--shift-radius" && has_value) {
+            options.shift_radius = std::atoi(argv[++i]);
+            if (options.shift_radius < 0 || options.shift_radius > MAX_SHIFT_RADIUS) {
+                std::cerr << "Error: --shift-radius must be 0 to " << MAX_SHIFT_RADIUS << std::endl;
+                return false;
+            }
+        } else if (arg == "--max-batch" && has_value) {
+            options.server.max_batch = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-wait-us" && has_value) {
+            options.server.max_wait_us = std::atoi(argv[++i]);
+        } else if (arg == "--batch-threads" && has_value) {
+            options.server.batch_threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else {
+            if (arg != "-h" && arg != "--help") std::cerr << "Error: Unknown or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    DaemonOptions options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.templates_path.empty()) {
+        options.templates_path = TemplateBank::is_bank_file("templates.bank") ? "templates.bank" : "templates.bin";
+    }
+
+    // Every reload re-reads the calibration too, so a new template set and
+    // its thresholds can be pushed together
+    RecognizerConfig base;
+    base.threshold = options.threshold >= 0 ? options.threshold : SAFE_THRESHOLD;
+    base.shift_radius = options.shift_radius >= 0 ? options.shift_radius : SHIFT_RADIUS;
+    auto loader = [options, base](const std::string& path) {
+        RecognizerConfig config = base;
+        std::string thresholds_path = options.thresholds_path;
+        if (thresholds_path.empty() && options.threshold < 0) {
+            std::string sibling = fs::path(path).replace_extension(".thresholds").string();
+            if (fs::exists(sibling)) thresholds_path = sibling;
+        }
+        if (!thresholds_path.empty()) {
+            use_threshold_calibration(config, load_threshold_calibration(thresholds_path));
+        }
+        return Recognizer::from_file(path, config);
+    };
+
+    // Signals are taken synchronously by this thread; block them before any
+    // other thread starts so they all inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::unique_ptr<ReloadableRecognizer> recognizer;
+    try {
+        recognizer = std::make_unique<ReloadableRecognizer>(options.templates_path, loader);
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading templates: " << e.what() << std::endl;
+        return 1;
+    }
+    if (recognizer->snapshot()->bank().empty()) {
+        std::cerr << "Error: No templates in " << options.templates_path << std::endl;
+        return 1;
+    }
+    if (options.watch) recognizer->watch();
+
+    RecognitionServer server(*recognizer, options.server);
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Serving " << recognizer->snapshot()->bank().size() << " templates on "
+              << options.server.socket_path << " (batches of up to " << options.server.max_batch << ", "
+              << options.server.max_wait_us << " us wait)" << std::endl;
+
+    for (;;) {
+        int signal = 0;
+        if (sigwait(&signals, &signal) != 0) continue;
+        if (signal == SIGHUP) {
+            recognizer->request_reload();
+            continue;
+        }
+        break;
+    }
+
+    server.stop();
+    recognizer->stop();
+    RecognitionServer::Stats stats = server.stats();
+    std::cerr << "Served " << stats.requests << " requests on " << stats.connections << " connections in "
+              << stats.batches << " batches (mean "
+              << (stats.batches ? static_cast<double>(stats.batched_glyphs) / stats.batches : 0.0) << " glyphs)"
+              << std::endl;
+    if (trace_level() >= TraceLevel::Counters) {
+        print_trace_counters(std::cerr);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Wire format of the recognized daemon (Unix stream socket). Every frame
+// is a 16-byte header plus payload; integers are little-endian. A client
+// may pipeline any number of requests on one connection. Responses carry
+// the request id and can come back out of order, since requests from one
+// connection may land in different micro-batches.
+//
+// Request:  magic "LRRQ" | u32 id | u8 kind | u8 top_k | u16 0 | u32 payload size | payload
+// Response: magic "LRRS" | u32 id | u8 status | u8 count | u16 0 | u32 generation
+//           | count x (u8 letter | u8 0 | u16 rotation | i32 distance)
+//
+// Matches come best first. With top_k 1 the match is masked like
+// Recognizer::recognize ('?' above the threshold); with more, the list is
+// unmasked like recognize_top_k. Both use the same matching strategy, so
+// the top-1 match is the head of the longer list up to ties in distance.
+// generation is the template bank in use (it goes up on every hot reload).
+
+static const uint32_t RECOGNIZED_REQUEST_MAGIC = 0x5152524C;   // "LRRQ"
+static const uint32_t RECOGNIZED_RESPONSE_MAGIC = 0x5352524C;  // "LRRS"
+static const size_t RECOGNIZED_HEADER_BYTES = 16;
+static const size_t RECOGNIZED_MATCH_BYTES = 8;
+static const size_t RECOGNIZED_TILE_SIZE = 64;  // Tiles are 64x64, 8-bit gray, row-major
+static const size_t RECOGNIZED_TILE_BYTES = RECOGNIZED_TILE_SIZE * RECOGNIZED_TILE_SIZE;
+static const uint32_t RECOGNIZED_MAX_PAYLOAD = 16u << 20;  // Larger requests close the connection
+static const size_t RECOGNIZED_MAX_TOP_K = 10;
+static const char RECOGNIZED_DEFAULT_SOCKET[] = "/tmp/recognized.sock";
+
+enum class RecognizedKind : uint8_t {
+    Image = 0,   // An encoded image file (JPEG, PNG, ...) holding one glyph
+    Tile = 1,    // A pre-warped glyph: RECOGNIZED_TILE_BYTES of gray pixels
+    Reload = 2,  // Reload the template file; empty payload, no matches back
+};
+
+enum class RecognizedStatus : uint8_t {
+    Ok = 0,
+    BadRequest = 1,    // Unknown kind, wrong payload size or top_k
+    DecodeFailed = 2,  // The image could not be decoded
+};
+
+struct RecognizedMatch {
+    char letter = '?';
+    int rotation = 0;
+    int distance = 0;
+};
+
+inline void recognized_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+inline void recognized_put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline uint16_t recognized_get_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t recognized_get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+struct RecognizedRequestHeader {
+    uint32_t id = 0;
+    RecognizedKind kind = RecognizedKind::Image;
+    uint8_t top_k = 1;
+    uint32_t payload_size = 0;
+
+    void write(uint8_t* p) const {
+        recognized_put_u32(p, RECOGNIZED_REQUEST_MAGIC);
+        recognized_put_u32(p + 4, id);
+        p[8] = static_cast<uint8_t>(kind);
+        p[9] = top_k;
+        recognized_put_u16(p + 10, 0);
+        recognized_put_u32(p + 12, payload_size);
+    }
+    // False on a bad magic (the stream is out of sync)
+    bool read(const uint8_t* p) {
+        if (recognized_get_u32(p) != RECOGNIZED_REQUEST_MAGIC) return false;
+        id = recognized_get_u32(p + 4);
+        kind = static_cast<RecognizedKind>(p[8]);
+        top_k = p[9];
+        payload_size = recognized_get_u32(p + 12);
+        return true;
+    }
+};
+
+struct RecognizedResponseHeader {
+    uint32_t id = 0;
+    RecognizedStatus status = RecognizedStatus::Ok;
+    uint8_t count = 0;
+    uint32_t generation = 0;
+
+    void write(uint8_t* p) const {
+        recognized_put_u32(p, RECOGNIZED_RESPONSE_MAGIC);
+        recognized_put_u32(p + 4, id);
+        p[8] = static_cast<uint8_t>(status);
+        p[9] = count;
+        recognized_put_u16(p + 10, 0);
+        recognized_put_u32(p + 12, generation);
+    }
+    bool read(const uint8_t* p) {
+        if (recognized_get_u32(p) != RECOGNIZED_RESPONSE_MAGIC) return false;
+        id = recognized_get_u32(p + 4);
+        status = static_cast<RecognizedStatus>(p[8]);
+        count = p[9];
+        generation = recognized_get_u32(p + 12);
+        return true;
+    }
+};
+
+inline void write_recognized_match(uint8_t* p, const RecognizedMatch& match) {
+    p[0] = static_cast<uint8_t>(match.letter);
+    p[1] = 0;
+    recognized_put_u16(p + 2, static_cast<uint16_t>(match.rotation));
+    recognized_put_u32(p + 4, static_cast<uint32_t>(match.distance));
+}
+
+inline RecognizedMatch read_recognized_match(const uint8_t* p) {
+    RecognizedMatch match;
+    match.letter = static_cast<char>(p[0]);
+    match.rotation = recognized_get_u16(p + 2);
+    match.distance = static_cast<int32_t>(recognized_get_u32(p + 4));
+    return match;
+}
@@ -0,0 +1,350 @@
+#include "recognizer.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+// Orientations a query is matched in: 0 plus the three quarter turns
+static const int QUERY_ROTATIONS[] = {0, 90, 180, 270};
+
+static bool resolve_rotate_queries(const TemplateBank& bank, RotationSearch search) {
+    if (search == RotationSearch::Auto) return bank.upright_only();
+    return search == RotationSearch::Query;
+}
+
+Recognizer::Recognizer() : bank_(std::make_shared<TemplateBank>()) {}
+
+Recognizer::Recognizer(std::shared_ptr<const TemplateBank> bank, RecognizerConfig config)
+    : bank_(bank ? std::move(bank) : std::make_shared<TemplateBank>()), config_(config),
+      rotate_queries_(resolve_rotate_queries(*bank_, config_.rotation_search)) {}
+
+Recognizer::Recognizer(const std::vector<Template>& templates, RecognizerConfig config)
+    : bank_(std::make_shared<TemplateBank>(templates)), config_(config),
+      rotate_queries_(resolve_rotate_queries(*bank_, config_.rotation_search)) {}
+
+Recognizer Recognizer::from_file(const std::string& path, RecognizerConfig config) {
+    if (TemplateBank::is_bank_file(path)) {
+        return Recognizer(std::make_shared<TemplateBank>(TemplateBank::open_mapped(path)), config);
+    }
+    bool text = path.size() >= 4 && path.compare(path.size() - 4, 4, ".txt") == 0;
+    return Recognizer(text ? read_templates_text(path) : read_templates_binary(path), config);
+}
+
+// Shared body of the single-glyph recognizers: the best K matches from one
+// distance pass. Everything guarded by `if constexpr (Trace::...)`
+// disappears from the Off instantiation.
+template<class Trace, size_t K>
+std::array<RecognitionResult, K> Recognizer::recognize_traced(const cv::Mat& image, RecognitionContext& context) const {
+    if constexpr (Trace::text) {
+        std::cout << "Input image: " << image.cols << "x" << image.rows << " channels: " << image.channels() << '\n';
+    }
+
+    uint8_t* query = context.query;
+    GlyphScratch& scratch = context.glyph;
+    if constexpr (Trace::images) {
+        // Step by step, so the intermediate images can be dumped
+        cv::resize(image, scratch.resized, cv::Size(64, 64));
+        debug_save_image(scratch.resized, "debug_resized.jpg");
+        adaptive_binarize(scratch.resized, scratch.binary);
+        debug_save_image(scratch.binary, "debug_binary.jpg");
+        scratch.packed.assign(TEMPLATE_BYTES, 0);
+        center_and_pack(scratch.binary, scratch.packed);
+        std::copy(scratch.packed.begin(), scratch.packed.end(), query);
+    } else {
+        preprocess_glyph(image, scratch, query);
+    }
+
+    if constexpr (Trace::text) {
+        int non_zero_bytes = 0;
+        for (size_t i = 0; i < TEMPLATE_BYTES; i++) {
+            if (query[i] != 0) non_zero_bytes++;
+        }
+        std::cout << "Packed data size: " << TEMPLATE_BYTES << " bytes\n";
+        std::cout << "Non-zero bytes in packed data: " << non_zero_bytes << '\n';
+    }
+
+    return match_traced<Trace, K>(query);
+}
+
+// One orientation of the shift-tolerant search: every offset within
+// shift_radius, each template keeping its best one. Coarse-to-fine
+// shortlists on the unshifted query; the 16x16 and 32x32 levels hardly
+// notice a few pixels of offset.
+template<size_t K>
+void Recognizer::match_shifted(const uint8_t* query, TopK<K>& top, int threshold, MatchStats& stats,
+                               int rotation, bool coarse_to_fine) const {
+    alignas(64) uint8_t shifted[MAX_SHIFTED_QUERIES * TEMPLATE_BYTES];
+    size_t n = shifted_queries(query, config_.shift_radius, shifted);
+    if (coarse_to_fine) {
+        static thread_local std::vector<uint32_t> candidates;  // Reused per thread
+        bank_->coarse_shortlist(query, 4 * K, candidates);
+        bank_->match_top_k_shifted(shifted, n, top, threshold, stats, rotation, &candidates);
+    } else {
+        bank_->match_top_k_shifted(shifted, n, top, threshold, stats, rotation);
+    }
+}
+
+template<class Trace, size_t K>
+std::array<RecognitionResult, K> Recognizer::match_traced(const uint8_t* query) const {
+    std::array<RecognitionResult, K> results;
+
+    const TemplateBank& bank = *bank_;
+    if (bank.empty()) {
+        std::cerr << "Warning: No templates loaded!" << std::endl;
+        return results;
+    }
+
+    if constexpr (Trace::text) debug_print_template_stats(bank);
+
+    // Text tracing always reports a top 5, whatever K the caller asked for
+    constexpr size_t TRACKED = Trace::text ? std::max<size_t>(K, 5) : K;
+    TopK<TRACKED> top;
+    MatchStats stats;
+    int threshold = config_.early_exit_at_threshold ? config_.threshold : INT_MAX;
+    bool coarse_to_fine = bank.size() >= config_.coarse_to_fine_min_templates;
+    // Shift-tolerant and coarse-to-fine matching never use the class index,
+    // so they never make the bank build it
+    bool by_class = config_.shift_radius == 0 && !coarse_to_fine && bank.class_count() > 0 &&
+                    bank.size() >= config_.class_index_min_class_size * bank.class_count();
+    // A glyph rotated clockwise by r matches the 0° templates once turned
+    // back by 360 - r and re-centred; every orientation feeds the same
+    // list, so the later ones are pruned against the best matches of the
+    // earlier ones
+    alignas(64) uint8_t turned[TEMPLATE_BYTES];
+    const size_t orientations = rotate_queries_ ? std::size(QUERY_ROTATIONS) : 1;
+    for (size_t r = 0; r < orientations; r++) {
+        int rotation = QUERY_ROTATIONS[r];
+        const uint8_t* q = query;
+        if (rotation != 0) {
+            rotate_bitplane(query, 360 - rotation, turned);
+            center_bitplane(turned, turned);
+            q = turned;
+        }
+        if (config_.shift_radius > 0) {
+            match_shifted(q, top, threshold, stats, rotation, coarse_to_fine);
+        } else if (coarse_to_fine) {
+            bank.match_top_k_coarse_to_fine(q, top, threshold, stats, rotation);
+        } else if (by_class) {
+            bank.match_top_k_by_class(q, top, threshold, stats, rotation);
+        } else {
+            bank.match_top_k_bounded(q, top, threshold, stats, rotation);
+        }
+    }
+    const RecognitionResult& best = top.best();
+
+    if constexpr (Trace::text) {
+        std::cout << "Min distance: " << best.confidence << " (threshold: " << config_.threshold << ")\n";
+        std::cout << "Best match: " << best.letter << " (rotation: " << best.rotation << "°)\n";
+        std::cout << "Top 5 matches (with rotation):\n";
+        for (size_t i = 0; i < std::min<size_t>(5, bank.size()); i++) {
+            const RecognitionResult& r = top.results()[i];
+            std::cout << "  " << r.letter << " (rotation: " << r.rotation << "°): " << r.confidence << '\n';
+        }
+        std::cout << std::flush;
+    }
+
+    if constexpr (Trace::counters) {
+        TraceCounters& counters = trace_counters();
+        counters.recognitions.fetch_add(1, std::memory_order_relaxed);
+        counters.templates_compared.fetch_add(stats.templates, std::memory_order_relaxed);
+        counters.lower_bound_pruned.fetch_add(stats.lower_bound_pruned, std::memory_order_relaxed);
+        counters.early_exit_pruned.fetch_add(stats.early_exit_pruned, std::memory_order_relaxed);
+        counters.coarse_pruned.fetch_add(stats.coarse_pruned, std::memory_order_relaxed);
+        counters.class_pruned.fetch_add(stats.class_pruned, std::memory_order_relaxed);
+        counters.classes_pruned.fetch_add(stats.classes_pruned, std::memory_order_relaxed);
+        if (rejects(best)) counters.rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::copy(top.results().begin(), top.results().begin() + K, results.begin());
+    return results;
+}
+
+RecognitionContext& thread_recognition_context() {
+    static thread_local RecognitionContext context;
+    return context;
+}
+
+template<size_t K>
+std::array<RecognitionResult, K> Recognizer::recognize_top_k(const cv::Mat& image) const {
+    return recognize_top_k<K>(image, thread_recognition_context());
+}
+
+template<size_t K>
+std::array<RecognitionResult, K> Recognizer::recognize_top_k(const cv::Mat& image, RecognitionContext& context) const {
+    return with_trace_policy([&](auto trace) {
+        return recognize_traced<decltype(trace), K>(image, context);
+    });
+}
+
+template<size_t K>
+std::array<RecognitionResult, K> Recognizer::match_top_k(const uint8_t* query) const {
+    return with_trace_policy([&](auto trace) {
+        return match_traced<decltype(trace), K>(query);
+    });
+}
+
+// Instantiations exported through recognizer.h
+template std::array<RecognitionResult, 1> Recognizer::recognize_top_k<1>(const cv::Mat&) const;
+template std::array<RecognitionResult, 2> Recognizer::recognize_top_k<2>(const cv::Mat&) const;
+template std::array<RecognitionResult, 3> Recognizer::recognize_top_k<3>(const cv::Mat&) const;
+template std::array<RecognitionResult, 5> Recognizer::recognize_top_k<5>(const cv::Mat&) const;
+template std::array<RecognitionResult, 10> Recognizer::recognize_top_k<10>(const cv::Mat&) const;
+template std::array<RecognitionResult, 1> Recognizer::recognize_top_k<1>(const cv::Mat&, RecognitionContext&) const;
+template std::array<RecognitionResult, 2> Recognizer::recognize_top_k<2>(const cv::Mat&, RecognitionContext&) const;
+template std::array<RecognitionResult, 3> Recognizer::recognize_top_k<3>(const cv::Mat&, RecognitionContext&) const;
+template std::array<RecognitionResult, 5> Recognizer::recognize_top_k<5>(const cv::Mat&, RecognitionContext&) const;
+template std::array<RecognitionResult, 10> Recognizer::recognize_top_k<10>(const cv::Mat&, RecognitionContext&) const;
+template std::array<RecognitionResult, 1> Recognizer::match_top_k<1>(const uint8_t*) const;
+template std::array<RecognitionResult, 2> Recognizer::match_top_k<2>(const uint8_t*) const;
+template std::array<RecognitionResult, 3> Recognizer::match_top_k<3>(const uint8_t*) const;
+template std::array<RecognitionResult, 5> Recognizer::match_top_k<5>(const uint8_t*) const;
+template std::array<RecognitionResult, 10> Recognizer::match_top_k<10>(const uint8_t*) const;
+
+bool Recognizer::rejects(const RecognitionResult& result) const {
+    if (result.confidence > config_.threshold) return true;
+    return config_.letter_thresholds &&
+           result.confidence > (*config_.letter_thresholds)[static_cast<unsigned char>(result.letter)];
+}
+
+RecognitionResult Recognizer::apply_threshold(RecognitionResult result) const {
+    // If confidence is too low, mark as unknown
+    if (rejects(result)) {
+        result.letter = '?';
+        result.rotation = 0;
+    }
+    return result;
+}
+
+RecognitionResult Recognizer::recognize(const cv::Mat& image) const {
+    return recognize(image, thread_recognition_context());
+}
+
+RecognitionResult Recognizer::recognize(const cv::Mat& image, RecognitionContext& context) const {
+    return apply_threshold(recognize_top_k<1>(image, context)[0]);
+}
+
+RecognitionResult Recognizer::match(const uint8_t* query) const {
+    return apply_threshold(match_top_k<1>(query)[0]);
+}
+
+std::vector<RecognitionResult> Recognizer::recognize_all(const std::vector<cv::Mat>& glyphs) const {
+    std::vector<RecognitionResult> results(glyphs.size());
+    recognize_all(glyphs, thread_recognition_context(), results.data());
+    return results;
+}
+
+void Recognizer::recognize_all(const std::vector<cv::Mat>& glyphs, RecognitionContext& context,
+                               RecognitionResult* out) const {
+    if (bank_->empty() || glyphs.empty()) {
+        if (bank_->empty()) std::cerr << "Warning: No templates loaded!" << std::endl;
+        std::fill(out, out + glyphs.size(), RecognitionResult());
+        return;
+    }
+    if (matches_one_by_one()) {
+        for(size_t i = 0; i < glyphs.size(); i++) out[i] = recognize(glyphs[i], context);
+        return;
+    }
+
+    // Pack every glyph into one contiguous query matrix (grows to the
+    // largest board seen, then stays), leaving room for its turned copies
+    const size_t orientations = rotate_queries_ ? std::size(QUERY_ROTATIONS) : 1;
+    context.queries.resize(glyphs.size() * orientations * TEMPLATE_BYTES);
+    for(size_t i = 0; i < glyphs.size(); i++) {
+        preprocess_glyph(glyphs[i], context.glyph, context.queries.data() + i * orientations * TEMPLATE_BYTES);
+    }
+    match_packed(glyphs.size(), context, out);
+}
+
+void Recognizer::match_all(const uint8_t* queries, size_t count, RecognitionContext& context,
+                           RecognitionResult* out) const {
+    if (bank_->empty() || count == 0) {
+        if (bank_->empty()) std::cerr << "Warning: No templates loaded!" << std::endl;
+        std::fill(out, out + count, RecognitionResult());
+        return;
+    }
+    if (matches_one_by_one()) {
+        for(size_t i = 0; i < count; i++) out[i] = match(queries + i * TEMPLATE_BYTES);
+        return;
+    }
+
+    const size_t orientations = rotate_queries_ ? std::size(QUERY_ROTATIONS) : 1;
+    context.queries.resize(count * orientations * TEMPLATE_BYTES);
+    for(size_t i = 0; i < count; i++) {
+        std::memcpy(context.queries.data() + i * orientations * TEMPLATE_BYTES, queries + i * TEMPLATE_BYTES,
+                    TEMPLATE_BYTES);
+    }
+    match_packed(count, context, out);
+}
+
+// The blocked M x N pass has no notion of offsets, and it is exhaustive:
+// on banks where match() takes the coarse-to-fine shortlist it could pick a
+// different best match, so those go through match() too
+bool Recognizer::matches_one_by_one() const {
+    return config_.shift_radius > 0 || bank_->size() >= config_.coarse_to_fine_min_templates;
+}
+
+void Recognizer::match_packed(size_t count, RecognitionContext& context, RecognitionResult* out) const {
+    const TemplateBank& bank = *bank_;
+    const size_t orientations = rotate_queries_ ? std::size(QUERY_ROTATIONS) : 1;
+    for(size_t i = 0; i < count; i++) {
+        uint8_t* query = context.queries.data() + i * orientations * TEMPLATE_BYTES;
+        for(size_t r = 1; r < orientations; r++) {
+            uint8_t* turned = query + r * TEMPLATE_BYTES;
+            rotate_bitplane(query, 360 - QUERY_ROTATIONS[r], turned);
+            center_bitplane(turned, turned);
+        }
+    }
+
+    if (orientations == 1) {
+        bank.top_k_MxN(context.queries.data(), count, 1, out);
+    } else {
+        // Best of the four orientations, first one on ties
+        context.candidates.resize(count * orientations);
+        bank.top_k_MxN(context.queries.data(), count * orientations, 1, context.candidates.data());
+        for(size_t i = 0; i < count; i++) {
+            const RecognitionResult* candidates = context.candidates.data() + i * orientations;
+            size_t best = 0;
+            for(size_t r = 1; r < orientations; r++) {
+                if (candidates[r].confidence < candidates[best].confidence) best = r;
+            }
+            out[i] = candidates[best];
+            if (best != 0) out[i].rotation = (out[i].rotation + QUERY_ROTATIONS[best]) % 360;
+        }
+    }
+
+    size_t rejected = 0;
+    for(size_t i = 0; i < count; i++) {
+        if (rejects(out[i])) rejected++;
+        out[i] = apply_threshold(out[i]);
+    }
+
+    if (LR_TRACE_MAX_LEVEL >= 1 && trace_level() >= TraceLevel::Counters) {
+        TraceCounters& counters = trace_counters();
+        counters.recognitions.fetch_add(count, std::memory_order_relaxed);
+        counters.templates_compared.fetch_add(count * orientations * bank.size(), std::memory_order_relaxed);
+        counters.rejected.fetch_add(rejected, std::memory_order_relaxed);
+    }
+}
+
+Recognizer default_recognizer() {
+    RecognizerConfig config;
+    config.threshold = SAFE_THRESHOLD;
+    config.early_exit_at_threshold = EARLY_EXIT_AT_THRESHOLD;
+    config.coarse_to_fine_min_templates = COARSE_TO_FINE_MIN_TEMPLATES;
+    config.class_index_min_class_size = CLASS_INDEX_MIN_CLASS_SIZE;
+    config.shift_radius = SHIFT_RADIUS;
+    config.letter_thresholds = std::atomic_load(&LETTER_THRESHOLDS);
+    return Recognizer(template_bank(), config);
+}
+
+void use_threshold_calibration(RecognizerConfig& config, const ThresholdCalibration& calibration, bool per_letter) {
+    if (per_letter && calibration.letter_thresholds) {
+        config.threshold = calibration.letter_threshold_max;
+        config.letter_thresholds = calibration.letter_thresholds;
+    } else {
+        config.threshold = calibration.threshold;
+        config.letter_thresholds.reset();
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "letter_recognition.h"
+#include "template_bank.h"
+#include <array>
+#include <climits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How glyphs rotated by 90/180/270 degrees are found
+enum class RotationSearch {
+    Auto,       // Query when the bank holds only 0° templates, else Templates
+    Templates,  // The bank holds rotated copies; the query is matched as is
+    Query,      // The query is matched in all four orientations (4 passes
+                // over a bank a quarter of the size)
+};
+
+// Matching parameters of one Recognizer (the free functions build theirs
+// from SAFE_THRESHOLD, EARLY_EXIT_AT_THRESHOLD, COARSE_TO_FINE_MIN_TEMPLATES,
+// CLASS_INDEX_MIN_CLASS_SIZE, SHIFT_RADIUS and LETTER_THRESHOLDS)
+struct RecognizerConfig {
+    int threshold = 200;                          // Reject above this distance
+    bool early_exit_at_threshold = false;         // See EARLY_EXIT_AT_THRESHOLD
+    size_t coarse_to_fine_min_templates = 4096;   // See COARSE_TO_FINE_MIN_TEMPLATES
+    size_t class_index_min_class_size = 4;        // See CLASS_INDEX_MIN_CLASS_SIZE
+    int shift_radius = 0;                         // See SHIFT_RADIUS (at most MAX_SHIFT_RADIUS)
+    RotationSearch rotation_search = RotationSearch::Auto;
+    // Optional per-letter limits: a match must also be within its letter's
+    // entry, so the table only tightens threshold (and early exit stays exact)
+    std::shared_ptr<const LetterThresholds> letter_thresholds;
+};
+
+// Applies a calibration (calibrate_threshold / load_threshold_calibration).
+// With per_letter and a table, threshold becomes the largest letter entry
+// and the table decides per letter; otherwise the global threshold is used.
+void use_threshold_calibration(RecognizerConfig& config, const ThresholdCalibration& calibration,
+                               bool per_letter = true);
+
+// Every intermediate buffer of a recognition, sized on first use and reused
+// afterwards, so steady-state recognition does not touch the heap (for
+// 64x64 input such as board cells; other sizes also go through cv::resize).
+// Not thread-safe: keep one per thread.
+struct RecognitionContext {
+    GlyphScratch glyph;
+    alignas(64) uint8_t query[TEMPLATE_BYTES];
+    std::vector<uint8_t> queries;  // recognize_all / match_all: packed queries (per orientation)
+    std::vector<RecognitionResult> candidates;  // recognize_all / match_all: best per orientation
+};
+
+// The calling thread's context (what the overloads without one use)
+RecognitionContext& thread_recognition_context();
+
+// An immutable template bank plus its configuration. Every recognize
+// method is const and keeps its scratch in a RecognitionContext, so one
+// Recognizer can serve any number of threads, and several can run side by
+// side on different template sets. Copies share the bank.
+class Recognizer {
+public:
+    // No templates: everything comes back '?'
+    Recognizer();
+    explicit Recognizer(std::shared_ptr<const TemplateBank> bank,
+                        RecognizerConfig config = RecognizerConfig());
+    explicit Recognizer(const std::vector<Template>& templates,
+                        RecognizerConfig config = RecognizerConfig());
+
+    // templates.bank (mapped), templates.txt (by extension) or the legacy
+    // record format. Throws std::runtime_error if the file cannot be read.
+    static Recognizer from_file(const std::string& path,
+                                RecognizerConfig config = RecognizerConfig());
+
+    const TemplateBank& bank() const { return *bank_; }
+    const std::shared_ptr<const TemplateBank>& shared_bank() const { return bank_; }
+    const RecognizerConfig& config() const { return config_; }
+    // Whether queries are turned (RotationSearch resolved against the bank)
+    bool rotates_queries() const { return rotate_queries_; }
+
+    // Best match, or '?' / rotation 0 when above the threshold
+    RecognitionResult recognize(const cv::Mat& image) const;
+    RecognitionResult recognize(const cv::Mat& image, RecognitionContext& context) const;
+    // Best K matches (best first), not masked by the threshold. Available
+    // for K = 1, 2, 3, 5 and 10.
+    template<size_t K>
+    std::array<RecognitionResult, K> recognize_top_k(const cv::Mat& image) const;
+    template<size_t K>
+    std::array<RecognitionResult, K> recognize_top_k(const cv::Mat& image, RecognitionContext& context) const;
+    // Whole-board recognition: all glyphs matched in one blocked pass (one
+    // match per glyph when shift_radius > 0 or the bank is large enough for
+    // coarse-to-fine, so the best match is always the one match() finds)
+    std::vector<RecognitionResult> recognize_all(const std::vector<cv::Mat>& glyphs) const;
+    // Same, into caller-owned storage for glyphs.size() results
+    void recognize_all(const std::vector<cv::Mat>& glyphs, RecognitionContext& context,
+                       RecognitionResult* out) const;
+    // Same on count queries already packed by preprocess_glyph (contiguous,
+    // TEMPLATE_BYTES each), for callers that batch glyphs from many sources
+    void match_all(const uint8_t* queries, size_t count, RecognitionContext& context,
+                   RecognitionResult* out) const;
+
+    // True if a match is above the threshold (or its letter's entry)
+    bool rejects(const RecognitionResult& result) const;
+
+    // The matching half on a query already packed by preprocess_glyph
+    // (TEMPLATE_BYTES), for callers that schedule the two halves separately
+    RecognitionResult match(const uint8_t* query) const;
+    template<size_t K>
+    std::array<RecognitionResult, K> match_top_k(const uint8_t* query) const;
+
+private:
+    template<class Trace, size_t K>
+    std::array<RecognitionResult, K> recognize_traced(const cv::Mat& image, RecognitionContext& context) const;
+    template<class Trace, size_t K>
+    std::array<RecognitionResult, K> match_traced(const uint8_t* query) const;
+    template<size_t K>
+    void match_shifted(const uint8_t* query, TopK<K>& top, int threshold, MatchStats& stats,
+                       int rotation, bool coarse_to_fine) const;
+    // The blocked pass of recognize_all / match_all over context.queries
+    // (each glyph's query first in its group of orientations)
+    void match_packed(size_t count, RecognitionContext& context, RecognitionResult* out) const;
+    bool matches_one_by_one() const;
+    RecognitionResult apply_threshold(RecognitionResult result) const;
+
+    std::shared_ptr<const TemplateBank> bank_;
+    RecognizerConfig config_;
+    bool rotate_queries_ = false;
+};
+
+// Recognizer over the global bank and the current global settings (what
+// the free functions in letter_recognition.h use)
+Recognizer default_recognizer();
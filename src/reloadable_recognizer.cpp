@@ -0,0 +1,243 @@
+#include "reloadable_recognizer.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#if defined(__linux__)
+    #include <cerrno>
+    #include <climits>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// A change is reloaded once the file has been quiet this long, so a writer
+// that closes and reopens it (or a burst of renames) costs one reload
+static const int RELOAD_SETTLE_MS = 100;
+
+ReloadableRecognizer::ReloadableRecognizer(std::string path, RecognizerConfig config)
+    : ReloadableRecognizer(std::move(path), [config](const std::string& file) {
+          return Recognizer::from_file(file, config);
+      }) {}
+
+ReloadableRecognizer::ReloadableRecognizer(std::string path, Loader loader)
+    : path_(std::move(path)), loader_(std::move(loader)) {
+    publish(loader_(path_));
+}
+
+ReloadableRecognizer::~ReloadableRecognizer() {
+    stop();
+}
+
+std::shared_ptr<const Recognizer> ReloadableRecognizer::snapshot() const {
+    return versioned_snapshot().recognizer;
+}
+
+uint64_t ReloadableRecognizer::generation() const {
+    return std::atomic_load(&current_)->generation;
+}
+
+ReloadableRecognizer::VersionedSnapshot ReloadableRecognizer::versioned_snapshot() const {
+    std::shared_ptr<const Published> published = std::atomic_load(&current_);
+    // Aliases the Published block, which stays alive while either is held
+    return {std::shared_ptr<const Recognizer>(published, &published->recognizer), published->generation};
+}
+
+void ReloadableRecognizer::publish(Recognizer recognizer) {
+    // Callers are serialized (constructor, or under reload_mutex_)
+    std::shared_ptr<const Published> current = std::atomic_load(&current_);
+    uint64_t generation = current ? current->generation + 1 : 1;
+    std::atomic_store(&current_, std::shared_ptr<const Published>(
+        std::make_shared<const Published>(Published{std::move(recognizer), generation})));
+}
+
+bool ReloadableRecognizer::reload() {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    Recognizer next;
+    try {
+        next = loader_(path_);
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Could not reload " << path_ << ": " << e.what() << " (keeping generation "
+                  << generation() << ")" << std::endl;
+        return false;
+    }
+    if (next.bank().empty()) {
+        std::cerr << "Warning: No templates in " << path_ << " (keeping generation " << generation() << ")" << std::endl;
+        return false;
+    }
+    size_t count = next.bank().size();
+    publish(std::move(next));
+    std::cerr << "Reloaded " << count << " templates from " << path_ << " (generation " << generation() << ")"
+              << std::endl;
+    return true;
+}
+
+void ReloadableRecognizer::watch(int poll_ms) {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (watcher_.joinable() && watching_file_) return;
+    }
+    stop();  // A thread that only served requests
+    start(true, poll_ms);
+}
+
+void ReloadableRecognizer::request_reload() {
+    start(false, 0);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        reload_requested_ = true;
+    }
+    wake();
+}
+
+// (time stamp, size) of a file; equal stamps mean "not rewritten"
+static std::pair<fs::file_time_type, uintmax_t> file_stamp(const std::string& path) {
+    std::error_code error;
+    fs::file_time_type time = fs::last_write_time(path, error);
+    uintmax_t size = error ? 0 : fs::file_size(path, error);
+    return {error ? fs::file_time_type::min() : time, error ? 0 : size};
+}
+
+#if defined(__linux__)
+// Non-blocking inotify descriptor watching the directory of path, or -1.
+// The directory rather than the file: a file replaced by rename is a new
+// inode, which a watch on the old one would never report.
+static int watch_directory_of(const std::string& path) {
+    fs::path file(path);
+    std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+#endif
+
+void ReloadableRecognizer::start(bool watch_file, int poll_ms) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    if (watcher_.joinable()) return;
+    stopping_ = false;
+    watching_file_ = watch_file;
+    // The watch (or the stamp polling compares against) is set up here, not
+    // on the new thread, so a change right after watch() returns is not lost
+    #if defined(__linux__)
+    if (watch_file && pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        wake_fds_[0] = wake_fds_[1] = -1;
+    }
+    if (watch_file && wake_fds_[0] >= 0) inotify_fd_ = watch_directory_of(path_);
+    #endif
+    watcher_ = std::thread(&ReloadableRecognizer::watch_loop, this, watch_file, poll_ms, file_stamp(path_));
+}
+
+void ReloadableRecognizer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (!watcher_.joinable()) return;
+        stopping_ = true;
+    }
+    wake();
+    watcher_.join();
+    #if defined(__linux__)
+    // Under the lock wake() writes under, so a concurrent request_reload
+    // never writes to a closed (or already reused) descriptor
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    for (int& fd : wake_fds_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    if (inotify_fd_ >= 0) close(inotify_fd_);
+    inotify_fd_ = -1;
+    #endif
+}
+
+void ReloadableRecognizer::wake() {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_cv_.notify_all();
+    #if defined(__linux__)
+    if (wake_fds_[1] >= 0) {
+        char byte = 1;
+        ssize_t written = write(wake_fds_[1], &byte, 1);
+        (void)written;  // A full pipe already has a wake-up pending
+    }
+    #endif
+}
+
+#if defined(__linux__)
+// Reads every queued event; true if one of them names the watched file
+static bool drain_events(int fd, const std::string& name) {
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    bool matched = false;
+    for (;;) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && name == event->name) matched = true;
+            if (event->mask & IN_Q_OVERFLOW) matched = true;
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    return matched;
+}
+#endif
+
+void ReloadableRecognizer::watch_loop(bool watch_file, int poll_ms, FileStamp stamp) {
+    #if defined(__linux__)
+    if (watch_file) {
+        std::string name = fs::path(path_).filename().string();
+        int fd = inotify_fd_;  // Closed by stop() after the join
+        if (fd >= 0) {
+            pollfd fds[2] = {{fd, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+            bool pending = false;
+            for (;;) {
+                // While a change is pending, wait only until the file settles
+                int ready = poll(fds, 2, pending ? RELOAD_SETTLE_MS : -1);
+                if (ready < 0 && errno != EINTR) break;
+                if (ready > 0 && (fds[1].revents & POLLIN)) {
+                    char bytes[64];
+                    while (read(wake_fds_[0], bytes, sizeof(bytes)) > 0) {}
+                }
+                bool requested = false;
+                {
+                    std::lock_guard<std::mutex> lock(wake_mutex_);
+                    if (stopping_) break;
+                    std::swap(requested, reload_requested_);
+                }
+                bool changed = ready > 0 && (fds[0].revents & POLLIN) && drain_events(fd, name);
+                if (requested || (pending && ready == 0)) {
+                    pending = false;
+                    reload();
+                } else if (changed) {
+                    pending = true;
+                }
+            }
+            return;
+        }
+        std::cerr << "Warning: inotify unavailable, polling " << path_ << " every " << poll_ms << " ms" << std::endl;
+    }
+    #endif
+
+    // Polling, or (without watch_file) waiting for requests only
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (!stopping_) {
+        auto woken = [this] { return stopping_ || reload_requested_; };
+        if (watch_file) {
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(poll_ms), woken);
+        } else {
+            wake_cv_.wait(lock, woken);
+        }
+        if (stopping_) break;
+        bool requested = false;
+        std::swap(requested, reload_requested_);
+        lock.unlock();
+        auto current = watch_file ? file_stamp(path_) : stamp;
+        if (requested || (current != stamp && current.second > 0)) {
+            stamp = current;
+            reload();
+        }
+        lock.lock();
+    }
+}
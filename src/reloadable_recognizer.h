@@ -0,0 +1,95 @@
+#pragma once
+#include "recognizer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// A Recognizer whose template file can be replaced while the process runs.
+// Readers take a snapshot (one atomic shared_ptr load, no lock) and match
+// against it until they are done; a reload builds the new Recognizer off
+// the read path and publishes it with an atomic swap. The old bank is
+// released when the last snapshot holding it goes away, so in-flight
+// recognitions never see it change or disappear.
+class ReloadableRecognizer {
+public:
+    // Builds the Recognizer for a path (default: Recognizer::from_file with
+    // the config). Should throw std::runtime_error on unreadable input.
+    using Loader = std::function<Recognizer(const std::string& path)>;
+
+    // Loads the file now; throws std::runtime_error if it cannot be read
+    explicit ReloadableRecognizer(std::string path, RecognizerConfig config = RecognizerConfig());
+    ReloadableRecognizer(std::string path, Loader loader);
+    ~ReloadableRecognizer();
+
+    ReloadableRecognizer(const ReloadableRecognizer&) = delete;
+    ReloadableRecognizer& operator=(const ReloadableRecognizer&) = delete;
+
+    // The current Recognizer and the generation it was published as
+    struct VersionedSnapshot {
+        std::shared_ptr<const Recognizer> recognizer;
+        uint64_t generation;
+    };
+
+    // The current Recognizer; stays valid (and unchanged) while held
+    std::shared_ptr<const Recognizer> snapshot() const;
+    // Bumped on every successful reload (1 after construction)
+    uint64_t generation() const;
+    // Both from one atomic load, so the generation always names the
+    // Recognizer it comes with (separate snapshot() and generation() calls
+    // can straddle a reload)
+    VersionedSnapshot versioned_snapshot() const;
+    const std::string& path() const { return path_; }
+
+    // Rebuilds from the file on the calling thread and publishes the result.
+    // On failure, or if the file holds no templates, the current Recognizer
+    // stays and false is returned (with a warning on std::cerr).
+    bool reload();
+
+    // Watches the file from a background thread and reloads after it has
+    // been rewritten or replaced (inotify on Linux, else polling its time
+    // stamp every poll_ms). The watch is in place when this returns, so any
+    // later change is seen. Atomic replacement (write + rename, as
+    // TemplateBank::save does) is picked up in one reload.
+    void watch(int poll_ms = 1000);
+    // The reload command: a background thread reloads as soon as it wakes
+    // (the watcher, or one that only serves requests); returns without
+    // waiting
+    void request_reload();
+    // Stops the background thread (also done by the destructor)
+    void stop();
+
+private:
+    // What one reload publishes: immutable, swapped in whole
+    struct Published {
+        Recognizer recognizer;
+        uint64_t generation;
+    };
+
+    void publish(Recognizer recognizer);
+    // (time stamp, size) of the file; equal stamps mean "not rewritten"
+    using FileStamp = std::pair<std::filesystem::file_time_type, uintmax_t>;
+
+    void start(bool watch_file, int poll_ms);
+    void watch_loop(bool watch_file, int poll_ms, FileStamp stamp);
+    void wake();
+
+    std::string path_;
+    Loader loader_;
+    std::shared_ptr<const Published> current_;  // accessed with std::atomic_load/store only
+    std::mutex reload_mutex_;  // serializes reloads, never taken by readers
+
+    std::thread watcher_;
+    std::mutex wake_mutex_;  // guards the fields below (and wake_fds_ writes)
+    std::condition_variable wake_cv_;
+    bool watching_file_ = false;
+    bool stopping_ = false;
+    bool reload_requested_ = false;
+    int wake_fds_[2] = {-1, -1};  // Linux: self-pipe that interrupts poll()
+    int inotify_fd_ = -1;         // Linux: watch on the file's directory
+};
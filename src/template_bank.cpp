@@ -0,0 +1,433 @@
+#include "template_bank.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#if defined(_WIN32)
+    #include <malloc.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static const char BANK_MAGIC[4] = {'L', 'R', 'T', 'B'};
+
+// std::aligned_alloc is missing from the Windows CRT
+static void* aligned_malloc(size_t alignment, size_t size) {
+    #if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+    #else
+    return std::aligned_alloc(alignment, size);
+    #endif
+}
+
+static void aligned_free(void* p) {
+    #if defined(_WIN32)
+    _aligned_free(p);
+    #else
+    std::free(p);
+    #endif
+}
+
+// Zeroed, 64-byte aligned heap image owned through a shared_ptr
+static std::shared_ptr<uint8_t> aligned_image(size_t bytes) {
+    // aligned_alloc needs a size that is a multiple of the alignment
+    size_t rounded = (bytes + TemplateBank::ALIGNMENT - 1) / TemplateBank::ALIGNMENT * TemplateBank::ALIGNMENT;
+    void* p = aligned_malloc(TemplateBank::ALIGNMENT, rounded);
+    if (!p) throw std::bad_alloc();
+    std::memset(p, 0, rounded);
+    return std::shared_ptr<uint8_t>(static_cast<uint8_t*>(p), aligned_free);
+}
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + TemplateBank::ALIGNMENT - 1) / TemplateBank::ALIGNMENT * TemplateBank::ALIGNMENT;
+}
+
+static TemplateBankHeader make_header(uint64_t count) {
+    TemplateBankHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, BANK_MAGIC, 4);
+    h.version = TEMPLATE_BANK_VERSION;
+    h.header_size = sizeof(TemplateBankHeader);
+    h.template_size = TEMPLATE_SIZE;
+    h.template_bytes = TEMPLATE_BYTES;
+    h.level32_bytes = PYRAMID_32_BYTES;
+    h.level16_bytes = PYRAMID_16_BYTES;
+    h.count = count;
+
+    uint64_t offset = align_up(sizeof(TemplateBankHeader));
+    h.bits_offset = offset;
+    offset = align_up(offset + count * TEMPLATE_BYTES);
+    h.level32_offset = offset;
+    offset = align_up(offset + count * PYRAMID_32_BYTES);
+    h.level16_offset = offset;
+    offset = align_up(offset + count * PYRAMID_16_BYTES);
+    h.popcounts_offset = offset;
+    offset = align_up(offset + count * sizeof(uint16_t));
+    h.rotations_offset = offset;
+    offset = align_up(offset + count * sizeof(int32_t));
+    h.letters_offset = offset;
+    h.file_size = align_up(offset + count);
+    return h;
+}
+
+static uint64_t fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Rejects anything this build cannot use in place
+static void validate_header(const TemplateBankHeader& h, uint64_t actual_size, const std::string& path) {
+    auto fail = [&](const std::string& why) {
+        throw std::runtime_error("Invalid template bank " + path + ": " + why);
+    };
+    if (std::memcmp(h.magic, BANK_MAGIC, 4) != 0) fail("bad magic");
+    if (h.version != TEMPLATE_BANK_VERSION) fail("unsupported version " + std::to_string(h.version));
+    if (h.header_size != sizeof(TemplateBankHeader)) fail("unexpected header size");
+    if (h.template_size != TEMPLATE_SIZE || h.template_bytes != TEMPLATE_BYTES ||
+        h.level32_bytes != PYRAMID_32_BYTES || h.level16_bytes != PYRAMID_16_BYTES) {
+        fail("template geometry does not match this build");
+    }
+    // Every template needs at least its bitplane in the file; this also
+    // keeps the section arithmetic below from wrapping on a forged count
+    if (h.count > (actual_size - sizeof(TemplateBankHeader)) / TEMPLATE_BYTES) fail("truncated file");
+    // The layout is fully determined by the count; anything else is corrupt
+    TemplateBankHeader expected = make_header(h.count);
+    if (h.bits_offset != expected.bits_offset || h.level32_offset != expected.level32_offset ||
+        h.level16_offset != expected.level16_offset || h.popcounts_offset != expected.popcounts_offset ||
+        h.rotations_offset != expected.rotations_offset || h.letters_offset != expected.letters_offset ||
+        h.file_size != expected.file_size) {
+        fail("inconsistent section offsets");
+    }
+    if (h.file_size > actual_size) fail("truncated file");
+}
+
+uint16_t popcount_bits(const uint8_t* bits) {
+    uint32_t count = 0;
+    for (int i = 0; i < TEMPLATE_BYTES; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, bits + i, 8);
+        count += __builtin_popcountll(v);
+    }
+    return static_cast<uint16_t>(count);
+}
+
+TemplateBank::TemplateBank(const std::vector<Template>& templates) {
+    TemplateBankHeader h = make_header(templates.size());
+    std::shared_ptr<uint8_t> image = aligned_image(h.file_size);
+    uint8_t* base = image.get();
+
+    for (size_t i = 0; i < templates.size(); i++) {
+        const Template& t = templates[i];
+        uint8_t* row = base + h.bits_offset + i * TEMPLATE_BYTES;
+        // Short (malformed) templates are zero-padded rather than over-read
+        size_t n = std::min(t.bits.size(), static_cast<size_t>(TEMPLATE_BYTES));
+        std::memcpy(row, t.bits.data(), n);
+        build_pyramid(row, base + h.level32_offset + i * PYRAMID_32_BYTES,
+                      base + h.level16_offset + i * PYRAMID_16_BYTES);
+        uint16_t popcount = popcount_bits(row);
+        int32_t rotation = t.rotation;
+        std::memcpy(base + h.popcounts_offset + i * sizeof(uint16_t), &popcount, sizeof(popcount));
+        std::memcpy(base + h.rotations_offset + i * sizeof(int32_t), &rotation, sizeof(rotation));
+        base[h.letters_offset + i] = static_cast<uint8_t>(t.letter);
+    }
+
+    h.checksum = fnv1a(base + h.header_size, h.file_size - h.header_size);
+    std::memcpy(base, &h, sizeof(h));
+    attach(image);
+}
+
+TemplateBank::TemplateBank(TemplateBank&& other) noexcept {
+    *this = std::move(other);
+}
+
+TemplateBank& TemplateBank::operator=(TemplateBank&& other) noexcept {
+    if (this != &other) {
+        image_ = std::move(other.image_);
+        header_ = other.header_;
+        bits_ = other.bits_;
+        level32_ = other.level32_;
+        level16_ = other.level16_;
+        popcounts_ = other.popcounts_;
+        rotations_ = other.rotations_;
+        letters_ = other.letters_;
+        count_ = other.count_;
+        upright_only_ = other.upright_only_;
+        class_index_ = std::move(other.class_index_);
+        other.header_ = nullptr;
+        other.bits_ = other.level32_ = other.level16_ = nullptr;
+        other.popcounts_ = nullptr;
+        other.rotations_ = nullptr;
+        other.letters_ = nullptr;
+        other.count_ = 0;
+        other.upright_only_ = false;
+    }
+    return *this;
+}
+
+void TemplateBank::attach(std::shared_ptr<const uint8_t> image) {
+    image_ = std::move(image);
+    const uint8_t* base = image_.get();
+    header_ = reinterpret_cast<const TemplateBankHeader*>(base);
+    count_ = header_->count;
+    bits_ = base + header_->bits_offset;
+    level32_ = base + header_->level32_offset;
+    level16_ = base + header_->level16_offset;
+    popcounts_ = reinterpret_cast<const uint16_t*>(base + header_->popcounts_offset);
+    rotations_ = reinterpret_cast<const int32_t*>(base + header_->rotations_offset);
+    letters_ = reinterpret_cast<const char*>(base + header_->letters_offset);
+    upright_only_ = count_ > 0 && std::all_of(rotations_, rotations_ + count_, [](int32_t r) { return r == 0; });
+}
+
+const TemplateBank::ClassIndex& TemplateBank::class_groups() const {
+    std::call_once(class_index_->grouped, [this] { group_classes(*class_index_); });
+    return *class_index_;
+}
+
+const TemplateBank::ClassIndex& TemplateBank::class_index() const {
+    const ClassIndex& groups = class_groups();
+    std::call_once(class_index_->built, [this] { build_prototypes(*class_index_); });
+    return groups;
+}
+
+void TemplateBank::group_classes(ClassIndex& index) const {
+    // Group by (letter, rotation), members in bank order
+    index.members.resize(count_);
+    for (size_t i = 0; i < count_; i++) index.members[i] = static_cast<uint32_t>(i);
+    std::stable_sort(index.members.begin(), index.members.end(), [this](uint32_t a, uint32_t b) {
+        if (letters_[a] != letters_[b]) return letters_[a] < letters_[b];
+        return rotations_[a] < rotations_[b];
+    });
+    for (size_t m = 0; m < count_; m++) {
+        uint32_t i = index.members[m];
+        if (index.classes.empty() || index.classes.back().letter != letters_[i] ||
+            index.classes.back().rotation != rotations_[i]) {
+            index.classes.push_back(TemplateClass{letters_[i], rotations_[i], static_cast<uint32_t>(m), 0, 0});
+        }
+        index.classes.back().count++;
+    }
+}
+
+void TemplateBank::build_prototypes(ClassIndex& index) const {
+    index.prototype_distances.assign(count_, 0);
+    if (index.classes.empty()) return;
+
+    // Majority-vote prototypes (ties clear the bit) and radii
+    index.prototypes = aligned_image(index.classes.size() * TEMPLATE_BYTES);
+    std::vector<uint32_t> votes(TEMPLATE_SIZE * TEMPLATE_SIZE);
+    for (size_t c = 0; c < index.classes.size(); c++) {
+        TemplateClass& cls = index.classes[c];
+        uint8_t* prototype = index.prototypes.get() + c * TEMPLATE_BYTES;
+        std::fill(votes.begin(), votes.end(), 0);
+        for (uint32_t m = cls.first; m < cls.first + cls.count; m++) {
+            const uint8_t* member = bits(index.members[m]);
+            for (int bit = 0; bit < TEMPLATE_SIZE * TEMPLATE_SIZE; bit++) {
+                votes[bit] += (member[bit / 8] >> (bit % 8)) & 1;
+            }
+        }
+        for (int bit = 0; bit < TEMPLATE_SIZE * TEMPLATE_SIZE; bit++) {
+            if (votes[bit] * 2 > cls.count) prototype[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+        }
+        for (uint32_t m = cls.first; m < cls.first + cls.count; m++) {
+            uint32_t i = index.members[m];
+            index.prototype_distances[i] = hamming_distance(prototype, bits(i));
+            cls.radius = std::max(cls.radius, index.prototype_distances[i]);
+        }
+    }
+}
+
+TemplateBank TemplateBank::open_mapped(const std::string& path) {
+    TemplateBank bank;
+    #if defined(_WIN32)
+    // No mmap here: one bulk read into an aligned image
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open template bank: " + path);
+    }
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    if (size < sizeof(TemplateBankHeader)) {
+        throw std::runtime_error("Invalid template bank " + path + ": truncated file");
+    }
+    std::shared_ptr<uint8_t> image = aligned_image(size);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(image.get()), size);
+    validate_header(*reinterpret_cast<const TemplateBankHeader*>(image.get()), size, path);
+    bank.attach(image);
+    #else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open template bank: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(TemplateBankHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid template bank " + path + ": truncated file");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map template bank: " + path);
+    }
+    std::shared_ptr<const uint8_t> image(static_cast<const uint8_t*>(mapped),
+                                         [size](const uint8_t* p) { munmap(const_cast<uint8_t*>(p), size); });
+    validate_header(*reinterpret_cast<const TemplateBankHeader*>(image.get()), size, path);
+    bank.attach(image);
+    #endif
+    return bank;
+}
+
+bool TemplateBank::is_bank_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    return file.read(magic, 4) && std::memcmp(magic, BANK_MAGIC, 4) == 0;
+}
+
+void TemplateBank::save(const std::string& path) const {
+    // An empty (default) bank still saves as a valid zero-template file
+    if (!image_) {
+        TemplateBank(std::vector<Template>()).save(path);
+        return;
+    }
+    // Written beside the target and renamed over it: a process that has the
+    // old file mapped keeps its pages, and a reader never sees a torn file
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not write template bank: " + path);
+        }
+        out.write(reinterpret_cast<const char*>(image_.get()), header_->file_size);
+        out.close();
+        if (!out) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Failed writing template bank: " + path);
+        }
+    }
+    #if defined(_WIN32)
+    std::remove(path.c_str());  // rename does not replace there
+    #endif
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not replace template bank: " + path);
+    }
+}
+
+bool TemplateBank::verify() const {
+    if (!image_) return true;
+    return fnv1a(image_.get() + header_->header_size, header_->file_size - header_->header_size) == header_->checksum;
+}
+
+void TemplateBank::distances_1xN(const uint8_t* query, uint16_t* out) const {
+    if (count_ == 0) return;
+    active_hamming_kernel().distances_1xN(query, bits_, count_, out);
+}
+
+void TemplateBank::distances_MxN(const uint8_t* queries, size_t m, uint16_t* out) const {
+    hamming_distances_MxN(queries, m, bits_, count_, out, count_);
+}
+
+// Templates scored per pass of top_k_MxN (256 KB of bits, kept hot in L2
+// while every query block runs over it), and queries per block. Together
+// they bound the distance matrix to a 16 KB stack buffer.
+static const size_t TOP_K_CHUNK = 512;
+static const size_t TOP_K_QUERY_BLOCK = 16;
+
+void TemplateBank::top_k_MxN(const uint8_t* queries, size_t m, size_t k, RecognitionResult* out) const {
+    std::fill(out, out + m * k, RecognitionResult());
+    if (k == 0 || m == 0) return;
+
+    uint16_t scratch[TOP_K_QUERY_BLOCK * TOP_K_CHUNK];
+    for (size_t t0 = 0; t0 < count_; t0 += TOP_K_CHUNK) {
+        size_t nt = std::min(count_ - t0, TOP_K_CHUNK);
+        for (size_t q0 = 0; q0 < m; q0 += TOP_K_QUERY_BLOCK) {
+            size_t nq = std::min(m - q0, TOP_K_QUERY_BLOCK);
+            hamming_distances_MxN(queries + q0 * TEMPLATE_BYTES, nq, bits(t0), nt, scratch, nt);
+
+            for (size_t q = 0; q < nq; q++) {
+                RecognitionResult* best = out + (q0 + q) * k;
+                const uint16_t* row = scratch + q * nt;
+                for (size_t j = 0; j < nt; j++) {
+                    int d = row[j];
+                    if (d >= best[k - 1].confidence) continue;
+                    // Insertion into the sorted k-list
+                    size_t pos = k - 1;
+                    while (pos > 0 && best[pos - 1].confidence > d) {
+                        best[pos] = best[pos - 1];
+                        pos--;
+                    }
+                    best[pos] = RecognitionResult(letters_[t0 + j], rotations_[t0 + j], d);
+                }
+            }
+        }
+    }
+}
+
+// Shortlist sizes: 1/8 of the bank survives the 16x16 level and 1/64 the
+// 32x32 level, with floors so small banks are barely pruned
+static const size_t COARSE_KEEP_DIVISOR = 8;
+static const size_t COARSE_KEEP_MIN = 256;
+static const size_t MEDIUM_KEEP_DIVISOR = 64;
+static const size_t MEDIUM_KEEP_MIN = 64;
+
+// Keeps the `keep` lowest-distance entries of scored
+static void keep_best(std::vector<std::pair<uint16_t, uint32_t>>& scored, size_t keep) {
+    if (keep >= scored.size()) return;
+    std::nth_element(scored.begin(), scored.begin() + keep, scored.end());
+    scored.resize(keep);
+}
+
+void TemplateBank::coarse_shortlist(const uint8_t* query, size_t min_keep, std::vector<uint32_t>& out) const {
+    uint8_t query32[PYRAMID_32_BYTES];
+    uint8_t query16[PYRAMID_16_BYTES];
+    build_pyramid(query, query32, query16);
+
+    // Per-thread, so it only grows to the largest bank seen
+    static thread_local std::vector<std::pair<uint16_t, uint32_t>> scored;
+    scored.resize(count_);
+    for (size_t i = 0; i < count_; i++) {
+        scored[i] = {hamming_distance_bytes(query16, bits16(i), PYRAMID_16_BYTES), static_cast<uint32_t>(i)};
+    }
+    keep_best(scored, std::max({count_ / COARSE_KEEP_DIVISOR, COARSE_KEEP_MIN, min_keep}));
+
+    for (auto& entry : scored) {
+        entry.first = hamming_distance_bytes(query32, bits32(entry.second), PYRAMID_32_BYTES);
+    }
+    keep_best(scored, std::max({count_ / MEDIUM_KEEP_DIVISOR, MEDIUM_KEEP_MIN, min_keep}));
+
+    // Bank order: sequential reads and the same tie-breaking as a full scan
+    out.clear();
+    for (const auto& entry : scored) out.push_back(entry.second);
+    std::sort(out.begin(), out.end());
+}
+
+// Replaced wholesale on reload and published with an atomic swap, so
+// recognition calls running meanwhile (each holds its own reference via
+// default_recognizer) finish on the previous bank, which is released after
+// the last of them. The new bank is fully built before it is published.
+static std::shared_ptr<const TemplateBank>& global_bank() {
+    static std::shared_ptr<const TemplateBank> bank = std::make_shared<TemplateBank>();
+    return bank;
+}
+
+std::shared_ptr<const TemplateBank> template_bank() {
+    return std::atomic_load(&global_bank());
+}
+
+void rebuild_template_bank() {
+    std::atomic_store(&global_bank(), std::shared_ptr<const TemplateBank>(std::make_shared<TemplateBank>(templates)));
+}
+
+void load_template_bank(const std::string& path) {
+    auto bank = std::make_shared<TemplateBank>(TemplateBank::open_mapped(path));
+    std::atomic_store(&global_bank(), std::shared_ptr<const TemplateBank>(std::move(bank)));
+}
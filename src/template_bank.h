@@ -0,0 +1,357 @@
+#pragma once
+#include "letter_recognition.h"
+#include "top_k.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-call pruning statistics of the bounded matcher
+struct MatchStats {
+    uint64_t templates = 0;           // Candidates considered
+    uint64_t lower_bound_pruned = 0;  // Skipped by |popcount(q) - popcount(t)|
+    uint64_t early_exit_pruned = 0;   // Abandoned mid-scan by the bounded kernel
+    uint64_t coarse_pruned = 0;       // Dropped by the 16x16 / 32x32 shortlist
+    uint64_t class_pruned = 0;        // Skipped by a class prototype bound
+    uint64_t classes_pruned = 0;      // Whole classes skipped (their templates
+                                      // are counted in class_pruned too)
+};
+
+// One (letter, rotation) class of a bank's pruning index
+struct TemplateClass {
+    char letter;
+    int rotation;
+    uint32_t first;   // Position of the first member in the member list
+    uint32_t count;   // Members
+    uint16_t radius;  // Largest member distance to the class prototype
+};
+
+// Number of set bits in a TEMPLATE_BYTES bitplane
+uint16_t popcount_bits(const uint8_t* bits);
+
+// On-disk bank file (templates.bank), little-endian. The header is
+// followed by 64-byte aligned sections; a bank built in memory uses the
+// exact same layout, so saving is one write and loading is one mmap.
+struct TemplateBankHeader {
+    char magic[4];              // "LRTB"
+    uint32_t version;           // TEMPLATE_BANK_VERSION
+    uint32_t header_size;       // sizeof(TemplateBankHeader)
+    uint32_t template_size;     // 64 (pixels per side)
+    uint32_t template_bytes;    // 512
+    uint32_t level32_bytes;     // 128
+    uint32_t level16_bytes;     // 32
+    uint32_t reserved0;
+    uint64_t count;
+    uint64_t bits_offset;       // count x template_bytes
+    uint64_t level32_offset;    // count x level32_bytes
+    uint64_t level16_offset;    // count x level16_bytes
+    uint64_t popcounts_offset;  // count x uint16
+    uint64_t rotations_offset;  // count x int32
+    uint64_t letters_offset;    // count x char
+    uint64_t file_size;
+    uint64_t checksum;          // FNV-1a 64 of bytes [header_size, file_size)
+    uint8_t reserved1[24];
+};
+static_assert(sizeof(TemplateBankHeader) == 128, "bank header layout changed");
+
+constexpr uint32_t TEMPLATE_BANK_VERSION = 1;
+
+// All templates packed into one contiguous, 64-byte aligned matrix
+// (TEMPLATE_BYTES per row) with letter, rotation, popcount and pyramid
+// levels in parallel arrays. Matching streams the matrix once instead of
+// chasing a heap pointer per Template.
+class TemplateBank {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    TemplateBank() = default;
+    explicit TemplateBank(const std::vector<Template>& templates);
+
+    // Maps a bank file read-only and uses it in place (nothing is parsed or
+    // copied; processes mapping the same file share its page cache).
+    // Throws std::runtime_error on a missing, truncated or foreign file.
+    static TemplateBank open_mapped(const std::string& path);
+    // True if the file starts with the bank magic
+    static bool is_bank_file(const std::string& path);
+
+    void save(const std::string& path) const;
+    // Recomputes the section checksum (reads every byte; not done on open)
+    bool verify() const;
+
+    TemplateBank(TemplateBank&& other) noexcept;
+    TemplateBank& operator=(TemplateBank&& other) noexcept;
+    TemplateBank(const TemplateBank&) = delete;
+    TemplateBank& operator=(const TemplateBank&) = delete;
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    const uint8_t* bits(size_t i) const { return bits_ + i * TEMPLATE_BYTES; }
+    const uint8_t* bits32(size_t i) const { return level32_ + i * PYRAMID_32_BYTES; }
+    const uint8_t* bits16(size_t i) const { return level16_ + i * PYRAMID_16_BYTES; }
+    const uint8_t* data() const { return bits_; }
+    char letter(size_t i) const { return letters_[i]; }
+    int rotation(size_t i) const { return rotations_[i]; }
+    uint16_t popcount(size_t i) const { return popcounts_[i]; }
+    // Pruning index: templates grouped by (letter, rotation), each class with
+    // a majority-vote prototype and its radius. Built on first use, not on
+    // load, so opening a mapped bank stays O(1) and banks never matched by
+    // class never pay for it. class_count() only groups (one sort of the
+    // letters and rotations); the rest builds the prototypes.
+    size_t class_count() const { return class_groups().classes.size(); }
+    const TemplateClass& template_class(size_t c) const { return class_index().classes[c]; }
+    const uint8_t* prototype(size_t c) const { return class_index().prototypes.get() + c * TEMPLATE_BYTES; }
+
+    // Non-empty and every template is a 0° one (rotations are found by
+    // turning the query instead, see RotationSearch)
+    bool upright_only() const { return upright_only_; }
+
+    // out must hold size() entries
+    void distances_1xN(const uint8_t* query, uint16_t* out) const;
+
+    // The matchers below report (rotation(i) + rotation_offset) % 360, so a
+    // query turned back by rotation_offset degrees is reported at its
+    // original orientation.
+
+    // Single distance pass feeding a compile-time sized best-K list
+    template<size_t K>
+    void match_top_k(const uint8_t* query, TopK<K>& top, int rotation_offset = 0) const {
+        Hamming1xNFn kernel = active_hamming_kernel().distances_1xN;
+        uint16_t distances[MATCH_CHUNK];
+        for (size_t t0 = 0; t0 < count_; t0 += MATCH_CHUNK) {
+            size_t nt = std::min(count_ - t0, MATCH_CHUNK);
+            kernel(query, bits(t0), nt, distances);
+            for (size_t j = 0; j < nt; j++) {
+                top.push(letters_[t0 + j], reported_rotation(t0 + j, rotation_offset), distances[j]);
+            }
+        }
+    }
+
+    // Branch-and-bound variant: a template is only scanned while it can
+    // still enter `top` and stay <= threshold. |popcount(q) - popcount(t)|
+    // is a free lower bound on the distance; the bounded kernel abandons a
+    // template after the first 64-byte chunk that exceeds the bound.
+    // With threshold < INT_MAX, nothing above it is ever reported.
+    template<size_t K>
+    void match_top_k_bounded(const uint8_t* query, TopK<K>& top, int threshold,
+                             MatchStats& stats, int rotation_offset = 0) const {
+        HammingBoundedFn kernel = active_hamming_kernel().distance_bounded;
+        int query_popcount = popcount_bits(query);
+        stats.templates += count_;
+        for (size_t i = 0; i < count_; i++) {
+            bounded_step(kernel, query, query_popcount, i, top, threshold, stats, rotation_offset);
+        }
+    }
+
+    // Coarse-to-fine: rank every template on the 16x16 level, re-rank the
+    // survivors on 32x32, and run the bounded 64x64 match on the final
+    // shortlist only. Approximate; meant for banks far larger than the
+    // shortlists (see COARSE_TO_FINE_MIN_TEMPLATES).
+    template<size_t K>
+    void match_top_k_coarse_to_fine(const uint8_t* query, TopK<K>& top, int threshold,
+                                    MatchStats& stats, int rotation_offset = 0) const {
+        static thread_local std::vector<uint32_t> candidates;  // Reused per thread
+        coarse_shortlist(query, 4 * K, candidates);
+        HammingBoundedFn kernel = active_hamming_kernel().distance_bounded;
+        int query_popcount = popcount_bits(query);
+        stats.templates += count_;
+        stats.coarse_pruned += count_ - candidates.size();
+        for (uint32_t i : candidates) {
+            bounded_step(kernel, query, query_popcount, i, top, threshold, stats, rotation_offset);
+        }
+    }
+
+    // Class-pruned variant of match_top_k_bounded with identical distances.
+    // The query is scored against every prototype first (one 1xN pass) and
+    // classes are visited nearest first. By the triangle inequality
+    // d(q, t) >= d(q, p) - radius for every member t of a class with
+    // prototype p, so a class whose bound cannot enter `top` (or stay under
+    // threshold) is skipped whole; inside a class |d(q, p) - d(p, t)|
+    // bounds each member before it is scanned.
+    template<size_t K>
+    void match_top_k_by_class(const uint8_t* query, TopK<K>& top, int threshold,
+                              MatchStats& stats, int rotation_offset = 0) const {
+        const ClassIndex& index = class_index();
+        HammingBoundedFn kernel = active_hamming_kernel().distance_bounded;
+        int query_popcount = popcount_bits(query);
+        size_t classes = index.classes.size();
+        // Per thread, so steady-state matching does not allocate
+        static thread_local std::vector<uint16_t> prototype_distances;
+        static thread_local std::vector<std::pair<uint16_t, uint32_t>> order;
+        prototype_distances.resize(classes);
+        order.resize(classes);
+        active_hamming_kernel().distances_1xN(query, index.prototypes.get(), classes, prototype_distances.data());
+        for (size_t c = 0; c < classes; c++) order[c] = {prototype_distances[c], static_cast<uint32_t>(c)};
+        std::sort(order.begin(), order.end());
+
+        stats.templates += count_;
+        for (const auto& entry : order) {
+            int to_prototype = entry.first;
+            const TemplateClass& cls = index.classes[entry.second];
+            int bound = std::min(top.worst() - 1, threshold);
+            if (to_prototype - cls.radius > bound) {
+                stats.classes_pruned++;
+                stats.class_pruned += cls.count;
+                continue;
+            }
+            for (uint32_t m = cls.first; m < cls.first + cls.count; m++) {
+                uint32_t i = index.members[m];
+                int lower_bound = to_prototype - index.prototype_distances[i];
+                if (lower_bound < 0) lower_bound = -lower_bound;
+                if (lower_bound > std::min(top.worst() - 1, threshold)) {
+                    stats.class_pruned++;
+                    continue;
+                }
+                bounded_step(kernel, query, query_popcount, i, top, threshold, stats, rotation_offset);
+            }
+        }
+    }
+
+    // Shift-tolerant matching: `queries` holds n shifted copies of one query
+    // (TEMPLATE_BYTES apart, see shifted_queries) and a template scores its
+    // best distance over all of them, so the bank needs no shifted copies.
+    // Each copy is scanned with the bound lowered to the template's best so
+    // far, so most offsets of a poor template stop after the first chunk.
+    // `candidates` (ascending indices, e.g. from coarse_shortlist) limits the
+    // scan; nullptr means every template.
+    template<size_t K>
+    void match_top_k_shifted(const uint8_t* queries, size_t n, TopK<K>& top, int threshold,
+                             MatchStats& stats, int rotation_offset = 0,
+                             const std::vector<uint32_t>* candidates = nullptr) const {
+        HammingBoundedFn kernel = active_hamming_kernel().distance_bounded;
+        int query_popcounts[MAX_SHIFTED_QUERIES];
+        n = std::min<size_t>(n, MAX_SHIFTED_QUERIES);
+        for (size_t s = 0; s < n; s++) query_popcounts[s] = popcount_bits(queries + s * TEMPLATE_BYTES);
+        stats.templates += count_;
+        if (candidates) {
+            stats.coarse_pruned += count_ - candidates->size();
+            for (uint32_t i : *candidates) {
+                shifted_step(kernel, queries, query_popcounts, n, i, top, threshold, stats, rotation_offset);
+            }
+        } else {
+            for (size_t i = 0; i < count_; i++) {
+                shifted_step(kernel, queries, query_popcounts, n, i, top, threshold, stats, rotation_offset);
+            }
+        }
+    }
+
+    // Indices (ascending) surviving the 16x16 and 32x32 pyramid levels;
+    // at least min_keep of them when the bank is that large. Reuses `out`
+    // and a per-thread buffer, so repeated calls do not allocate.
+    void coarse_shortlist(const uint8_t* query, size_t min_keep, std::vector<uint32_t>& out) const;
+
+    // m queries (contiguous, TEMPLATE_BYTES stride) against every template;
+    // out is an m x size() row-major matrix
+    void distances_MxN(const uint8_t* queries, size_t m, uint16_t* out) const;
+
+    // Best k matches per query, best first, without materializing the full
+    // distance matrix. out is m x k; unused slots keep letter '?'.
+    void top_k_MxN(const uint8_t* queries, size_t m, size_t k, RecognitionResult* out) const;
+
+private:
+    int reported_rotation(size_t i, int rotation_offset) const {
+        return rotation_offset == 0 ? rotations_[i] : (rotations_[i] + rotation_offset) % 360;
+    }
+
+    template<size_t K>
+    void bounded_step(HammingBoundedFn kernel, const uint8_t* query, int query_popcount,
+                      size_t i, TopK<K>& top, int threshold, MatchStats& stats,
+                      int rotation_offset) const {
+        // Must be strictly better than the current k-th best to enter
+        int bound = std::min(top.worst() - 1, threshold);
+        int lower_bound = query_popcount - popcounts_[i];
+        if (lower_bound < 0) lower_bound = -lower_bound;
+        if (lower_bound > bound) {
+            stats.lower_bound_pruned++;
+            return;
+        }
+        int d = kernel(query, bits(i), bound);
+        if (d > bound) {
+            stats.early_exit_pruned++;
+            return;
+        }
+        top.push(letters_[i], reported_rotation(i, rotation_offset), d);
+    }
+
+    template<size_t K>
+    void shifted_step(HammingBoundedFn kernel, const uint8_t* queries, const int* query_popcounts,
+                      size_t n, size_t i, TopK<K>& top, int threshold, MatchStats& stats,
+                      int rotation_offset) const {
+        int bound = std::min(top.worst() - 1, threshold);
+        int best = -1;
+        bool scanned = false;
+        for (size_t s = 0; s < n; s++) {
+            int lower_bound = query_popcounts[s] - popcounts_[i];
+            if (lower_bound < 0) lower_bound = -lower_bound;
+            if (lower_bound > bound) continue;
+            scanned = true;
+            int d = kernel(queries + s * TEMPLATE_BYTES, bits(i), bound);
+            if (d > bound) continue;
+            // Later offsets must be strictly better; ties keep the nearer one
+            best = d;
+            bound = d - 1;
+        }
+        if (best < 0) {
+            if (scanned) stats.early_exit_pruned++;
+            else stats.lower_bound_pruned++;
+            return;
+        }
+        top.push(letters_[i], reported_rotation(i, rotation_offset), best);
+    }
+
+    // Templates scored per kernel call by the streaming matchers (stack buffer)
+    static constexpr size_t MATCH_CHUNK = 256;
+
+    // (letter, rotation) classes and what match_top_k_by_class needs of
+    // them. Each half is built once, by whichever thread gets there first.
+    struct ClassIndex {
+        std::once_flag grouped;
+        std::once_flag built;
+        std::vector<TemplateClass> classes;
+        std::vector<uint32_t> members;               // Template indices, grouped by class
+        std::shared_ptr<uint8_t> prototypes;         // classes.size() x TEMPLATE_BYTES, aligned
+        std::vector<uint16_t> prototype_distances;   // Per template: distance to its prototype
+    };
+
+    // Points the section pointers into image_ (header already validated)
+    void attach(std::shared_ptr<const uint8_t> image);
+    // The index with its classes grouped (radii still 0, no prototypes)
+    const ClassIndex& class_groups() const;
+    // The complete index
+    const ClassIndex& class_index() const;
+    void group_classes(ClassIndex& index) const;
+    void build_prototypes(ClassIndex& index) const;
+
+    // Header + sections, either heap-allocated or a read-only mapping
+    std::shared_ptr<const uint8_t> image_;
+    const TemplateBankHeader* header_ = nullptr;
+    const uint8_t* bits_ = nullptr;
+    const uint8_t* level32_ = nullptr;
+    const uint8_t* level16_ = nullptr;
+    const uint16_t* popcounts_ = nullptr;
+    const int32_t* rotations_ = nullptr;
+    const char* letters_ = nullptr;
+    size_t count_ = 0;
+    bool upright_only_ = false;
+
+    // Class index (in memory only; the file format is unchanged). Behind a
+    // pointer so the bank stays movable; null only in a moved-from bank.
+    std::unique_ptr<ClassIndex> class_index_ = std::make_unique<ClassIndex>();
+};
+
+// Bank used by the free recognition functions. The text/legacy loaders
+// rebuild it from the global `templates` vector; call
+// rebuild_template_bank() after editing `templates` by hand. Reloading is
+// safe while other threads recognize: the returned bank stays valid (and
+// unchanged) for as long as it is held.
+std::shared_ptr<const TemplateBank> template_bank();
+void rebuild_template_bank();
+// Maps a bank file as the global bank without touching `templates`
+void load_template_bank(const std::string& path);
+
+// Letter counts and blank templates of a bank (the no-argument version in
+// letter_recognition.h reports the global bank)
+void debug_print_template_stats(const TemplateBank& bank);
@@ -1,97 +1,59 @@
 #include "letter_recognition.h"
-#include <filesystem>
+#include "template_bank.h"
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
-#include <opencv2/core.hpp>
-#include <opencv2/imgproc.hpp>
-#include <opencv2/imgcodecs.hpp>
-#include <opencv2/highgui.hpp>
+#include <string>
 #include <vector>
 
-namespace fs = std::filesystem;
+int main(int argc, char** argv) {
+    // --upright-only: keep the _0_ images. The recognizer then turns each
+    // query instead of matching 4x as many stored rotations.
+    bool upright_only = false;
+    // --calibrate DIR [--target-far F]: fit the reject thresholds to the
+    // validation glyphs in DIR and write templates.thresholds
+    std::string validation_dir;
+    double target_far = 0.001;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--upright-only") upright_only = true;
+        else if (arg == "--calibrate" && i + 1 < argc) validation_dir = argv[++i];
+        else if (arg == "--target-far" && i + 1 < argc) target_far = std::atof(argv[++i]);
+    }
+
+    // Every dataset image, preprocessed like a query. No shifted copies:
+    // the matcher searches a +-SHIFT_RADIUS window at match time instead
+    // (RecognizerConfig::shift_radius).
+    std::vector<Template> generated = read_templates_dataset("../../dataset", upright_only);
 
-int main() {
-    // Create output file
+    // Legacy record format; templates.bank is written below
     std::ofstream out("templates.bin", std::ios::binary);
+    for (const Template& t : generated) {
+        out.write(&t.letter, 1);
+        out.write(reinterpret_cast<const char*>(&t.rotation), sizeof(int));
+        out.write(reinterpret_cast<const char*>(t.bits.data()), 512);  // 512 bytes for 64x64
+    }
     
-    // Process all images in dataset directory
-    for (const auto& entry : fs::directory_iterator("../../dataset")) {
-        if (entry.path().extension() != ".jpg") continue;
-        
-        // Parse filename
-        std::string filename = entry.path().stem().string();
-        
-        // Find the first underscore to get the letter
-        size_t first_underscore = filename.find('_');
-        if (first_underscore == std::string::npos) {
-            std::cerr << "Warning: Skipping file with invalid format: " << filename << std::endl;
-            continue;
-        }
-        
-        // Extract letter (could be multiple characters like "div", "mul", etc.)
-        std::string letter_str = filename.substr(0, first_underscore);
-        char letter = letter_str[0]; // Use first character as the main letter
-        
-        // Find the second underscore to get the rotation
-        size_t second_underscore = filename.find('_', first_underscore + 1);
-        if (second_underscore == std::string::npos) {
-            std::cerr << "Warning: Skipping file with invalid format: " << filename << std::endl;
-            continue;
-        }
-        
-        // Extract rotation number
-        std::string rotation_str = filename.substr(first_underscore + 1, second_underscore - first_underscore - 1);
-        int rotation;
+    // Versioned, mmap-able bank with the pyramid levels precomputed
+    TemplateBank(generated).save("templates.bank");
+    save_templates_text("templates.txt", generated);
+    std::cout << "Wrote " << generated.size() << " templates to templates.bin, templates.bank and templates.txt" << std::endl;
+
+    if (!validation_dir.empty()) {
+        templates = generated;
+        rebuild_template_bank();
         try {
-            rotation = std::stoi(rotation_str);
-        } catch (const std::invalid_argument& e) {
-            std::cerr << "Warning: Invalid rotation number in file: " << filename << " (rotation: " << rotation_str << ")" << std::endl;
-            continue;
+            ThresholdCalibration calibration = calibrate_threshold(validation_dir, target_far);
+            save_threshold_calibration("templates.thresholds", calibration);
+            std::cout << "Threshold " << calibration.threshold << " for FAR " << target_far << ": FAR "
+                      << calibration.false_accept_rate << ", FRR " << calibration.false_reject_rate << " ("
+                      << calibration.genuine << " genuine, " << calibration.impostor << " impostor distances); "
+                      << "per-letter thresholds up to " << calibration.letter_threshold_max
+                      << ", written to templates.thresholds" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error calibrating thresholds: " << e.what() << std::endl;
+            return 1;
         }
-        
-        // Load image (already cropped)
-        cv::Mat img = cv::imread(entry.path().string());
-        if (img.empty()) continue;
-        
-        // Resize to standard size (64x64)
-        cv::Mat resized;
-        cv::resize(img, resized, cv::Size(64, 64));
-        
-        // Process image
-        cv::Mat binary;
-        adaptive_binarize(resized, binary);
-        
-        // Generate 9 shifted versions (±1 pixel tolerance)
-        /*
-        for (int dx : {-1, 0, 1}) {
-            for (int dy : {-1, 0, 1}) {
-                Template t;
-                t.letter = letter;
-                t.rotation = rotation;
-                
-                // Shift and pack
-                center_and_pack(binary, t.bits);
-                
-                // Save to file
-                out.write(&t.letter, 1);
-                out.write(reinterpret_cast<char*>(&t.rotation), sizeof(int));
-                out.write(reinterpret_cast<char*>(t.bits.data()), 512);  // 512 bytes for 64x64
-            }
-        }
-        */
-        
-        // Generate single unshifted version
-        Template t;
-        t.letter = letter;
-        t.rotation = rotation;
-        
-        // Pack without shifting
-        center_and_pack(binary, t.bits);
-        
-        // Save to file
-        out.write(&t.letter, 1);
-        out.write(reinterpret_cast<char*>(&t.rotation), sizeof(int));
-        out.write(reinterpret_cast<char*>(t.bits.data()), 512);  // 512 bytes for 64x64
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "recognizer.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+
+// Steady-state recognition must not touch the heap: after one warm-up
+// pass over the glyphs, every further recognition is counted through the
+// replaced global operator new and must allocate nothing.
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+static std::vector<Template> random_templates(std::mt19937& rng) {
+    std::vector<Template> list;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            for (int v = 0; v < 5; v++) {
+                Template t;
+                t.letter = letter;
+                t.rotation = rotation;
+                t.bits.resize(TEMPLATE_BYTES);
+                for (auto& byte : t.bits) byte = static_cast<uint8_t>(rng() & rng());
+                list.push_back(std::move(t));
+            }
+        }
+    }
+    return list;
+}
+
+// Board-cell sized glyphs: a dark rectangle on a light background
+static std::vector<cv::Mat> random_glyphs(size_t count, std::mt19937& rng) {
+    std::vector<cv::Mat> glyphs;
+    for (size_t i = 0; i < count; i++) {
+        cv::Mat glyph(64, 64, CV_8UC3, cv::Scalar(255, 255, 255));
+        int x0 = 8 + rng() % 16, y0 = 8 + rng() % 16;
+        int x1 = x0 + 8 + rng() % 24, y1 = y0 + 8 + rng() % 24;
+        for (int y = y0; y < y1; y++) {
+            uint8_t* row = glyph.ptr<uint8_t>(y);
+            for (int x = x0; x < x1; x++) {
+                row[x * 3] = row[x * 3 + 1] = row[x * 3 + 2] = 0;
+            }
+        }
+        glyphs.push_back(glyph);
+    }
+    return glyphs;
+}
+
+// Runs `body` once to warm up, then again with allocations counted
+template<class F>
+static bool expect_no_allocations(const char* name, size_t glyphs, F body) {
+    body();
+    size_t before = allocations.load();
+    body();
+    size_t count = allocations.load() - before;
+    if (count == 0) {
+        std::cout << "✓ " << name << ": 0 allocations for " << glyphs << " glyphs" << std::endl;
+        return true;
+    }
+    std::cout << "✗ " << name << ": " << count << " allocations for " << glyphs << " glyphs" << std::endl;
+    return false;
+}
+
+int main() {
+    std::cout << "=== Steady-State Allocation Test ===" << std::endl;
+
+    std::mt19937 rng(17);
+    templates = random_templates(rng);
+    rebuild_template_bank();
+    std::vector<cv::Mat> glyphs = random_glyphs(200, rng);
+
+    Recognizer recognizer(templates);
+    RecognizerConfig coarse;
+    coarse.coarse_to_fine_min_templates = 1;  // Force the pyramid shortlist
+    Recognizer coarse_recognizer(templates, coarse);
+
+    RecognitionContext context;
+    std::vector<RecognitionResult> results(glyphs.size());
+    uint8_t query[TEMPLATE_BYTES];
+    int checksum = 0;  // Keeps the calls from being optimized away
+    bool ok = true;
+
+    ok &= expect_no_allocations("Recognizer::recognize(image, context)", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += recognizer.recognize(glyph, context).confidence;
+    });
+    ok &= expect_no_allocations("Recognizer::recognize(image)", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += recognizer.recognize(glyph).confidence;
+    });
+    ok &= expect_no_allocations("Recognizer::recognize_top_k<5>", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += recognizer.recognize_top_k<5>(glyph, context)[4].confidence;
+    });
+    ok &= expect_no_allocations("coarse-to-fine recognize", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += coarse_recognizer.recognize(glyph, context).confidence;
+    });
+    RecognizerConfig shifted;
+    shifted.shift_radius = 2;
+    Recognizer shift_recognizer(templates, shifted);
+    ok &= expect_no_allocations("shift-tolerant recognize", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += shift_recognizer.recognize(glyph, context).confidence;
+    });
+    ok &= expect_no_allocations("preprocess_glyph + Recognizer::match", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) {
+            preprocess_glyph(glyph, context.glyph, query);
+            checksum += recognizer.match(query).confidence;
+        }
+    });
+    ok &= expect_no_allocations("Recognizer::recognize_all(glyphs, context, out)", glyphs.size(), [&] {
+        recognizer.recognize_all(glyphs, context, results.data());
+        checksum += results[0].confidence;
+    });
+    ok &= expect_no_allocations("recognize_letter_with_rotation", glyphs.size(), [&] {
+        for (const cv::Mat& glyph : glyphs) checksum += recognize_letter_with_rotation(glyph).confidence;
+    });
+
+    // Same results with and without the caller's context
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        RecognitionResult a = recognizer.recognize(glyphs[i], context);
+        RecognitionResult b = recognizer.recognize(glyphs[i]);
+        if (a.letter != b.letter || a.confidence != b.confidence || a.confidence != results[i].confidence) {
+            std::cout << "✗ Results differ on glyph " << i << std::endl;
+            ok = false;
+            break;
+        }
+    }
+
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#include "recognizer.h"
+#include "test_shapes.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+
+// Threshold calibration tests: the batched, parallel calibration must
+// report exactly the rates a brute force pass over the same distances
+// gives, pick the largest threshold within the target false-accept rate,
+// and survive a save / load round trip; per-letter tables must reject
+// like their entries say. When even exact impostors exceed the target,
+// the calibration rejects everything rather than claim a FAR it misses.
+
+// Fraction of values <= threshold
+static double rate_within(const std::vector<int>& values, int threshold) {
+    size_t within = 0;
+    for (int v : values) within += v <= threshold;
+    return values.empty() ? 0.0 : static_cast<double>(within) / values.size();
+}
+
+int main() {
+    std::cout << "=== Threshold Calibration Test ===" << std::endl;
+    std::mt19937 rng(23);
+    int failures = 0;
+
+    // 26 letters x 4 rotations, 5 samples each; queries are further noisy
+    // samples, some heavily corrupted so the two distributions overlap
+    std::vector<Template> list;
+    std::vector<std::vector<uint8_t>> bases;
+    std::vector<char> base_letters;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            std::vector<uint8_t> base(TEMPLATE_BYTES);
+            random_shape(rng, base.data());
+            for (int s = 0; s < 5; s++) {
+                Template t;
+                t.letter = letter;
+                t.rotation = rotation;
+                t.bits = base;
+                flip_bits(rng, t.bits.data(), 60);
+                list.push_back(t);
+            }
+            bases.push_back(base);
+            base_letters.push_back(letter);
+        }
+    }
+    TemplateBank bank(list);
+
+    const size_t count = 2000;
+    std::vector<uint8_t> queries(count * TEMPLATE_BYTES);
+    std::vector<char> labels(count);
+    for (size_t q = 0; q < count; q++) {
+        size_t b = rng() % bases.size();
+        std::memcpy(queries.data() + q * TEMPLATE_BYTES, bases[b].data(), TEMPLATE_BYTES);
+        flip_bits(rng, queries.data() + q * TEMPLATE_BYTES, 100 + rng() % 1200);
+        labels[q] = base_letters[b];
+    }
+
+    const double target_far = 0.01;
+    auto start = std::chrono::steady_clock::now();
+    ThresholdCalibration calibration = calibrate_threshold(bank, queries.data(), labels.data(), count, target_far);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Calibrated " << count << " glyphs x " << bank.size() << " templates in " << ms << " ms: threshold "
+              << calibration.threshold << ", FAR " << calibration.false_accept_rate << ", FRR "
+              << calibration.false_reject_rate << ", letters up to " << calibration.letter_threshold_max << std::endl;
+
+    // Brute force: best distance of every glyph to every letter
+    std::vector<int> genuine, impostor;
+    std::map<char, std::vector<int>> letter_impostor;
+    for (size_t q = 0; q < count; q++) {
+        std::map<char, int> best;
+        for (const Template& t : list) {
+            int d = hamming_distance(queries.data() + q * TEMPLATE_BYTES, t.bits.data());
+            auto it = best.find(t.letter);
+            if (it == best.end() || d < it->second) best[t.letter] = d;
+        }
+        for (const auto& entry : best) {
+            if (entry.first == labels[q]) {
+                genuine.push_back(entry.second);
+            } else {
+                impostor.push_back(entry.second);
+                letter_impostor[entry.first].push_back(entry.second);
+            }
+        }
+    }
+
+    double far = rate_within(impostor, calibration.threshold);
+    double frr = 1.0 - rate_within(genuine, calibration.threshold);
+    bool counts_ok = calibration.genuine == genuine.size() && calibration.impostor == impostor.size();
+    bool rates_ok = std::abs(far - calibration.false_accept_rate) < 1e-12 &&
+                    std::abs(frr - calibration.false_reject_rate) < 1e-12;
+    bool largest = far <= target_far && rate_within(impostor, calibration.threshold + 1) > target_far;
+    if (counts_ok && rates_ok && largest) {
+        std::cout << "✓ Threshold, FAR and FRR match brute force (largest threshold within the target)" << std::endl;
+    } else {
+        std::cout << "✗ Calibration differs from brute force: FAR " << far << " FRR " << frr << " (counts "
+                  << (counts_ok ? "ok" : "differ") << ")" << std::endl;
+        failures++;
+    }
+
+    int letter_mismatches = 0;
+    for (const auto& entry : letter_impostor) {
+        int threshold = (*calibration.letter_thresholds)[static_cast<unsigned char>(entry.first)];
+        if (rate_within(entry.second, threshold) > target_far ||
+            rate_within(entry.second, threshold + 1) <= target_far) {
+            letter_mismatches++;
+        }
+    }
+    if (letter_mismatches == 0) {
+        std::cout << "✓ Per-letter thresholds are the largest within the target for every letter" << std::endl;
+    } else {
+        std::cout << "✗ " << letter_mismatches << " per-letter thresholds are off" << std::endl;
+        failures++;
+    }
+
+    // Save / load
+    const char* path = "test_calibration.thresholds";
+    save_threshold_calibration(path, calibration);
+    ThresholdCalibration loaded = load_threshold_calibration(path);
+    std::remove(path);
+    bool round_trip = loaded.threshold == calibration.threshold && loaded.genuine == calibration.genuine &&
+                      loaded.roc.size() == calibration.roc.size() &&
+                      loaded.letter_threshold_max == calibration.letter_threshold_max &&
+                      loaded.letter_thresholds && *loaded.letter_thresholds == *calibration.letter_thresholds;
+    if (round_trip) {
+        std::cout << "✓ Save / load round trip (" << loaded.roc.size() << " ROC points)" << std::endl;
+    } else {
+        std::cout << "✗ Loaded calibration differs from the saved one" << std::endl;
+        failures++;
+    }
+
+    // A Recognizer using the table rejects exactly above each letter's entry
+    RecognizerConfig config;
+    use_threshold_calibration(config, loaded);
+    Recognizer recognizer(list, config);
+    int reject_mismatches = 0;
+    for (size_t q = 0; q < count; q++) {
+        RecognitionResult best = recognizer.match_top_k<1>(queries.data() + q * TEMPLATE_BYTES)[0];
+        bool expected = best.confidence > (*loaded.letter_thresholds)[static_cast<unsigned char>(best.letter)];
+        RecognitionResult masked = recognizer.match(queries.data() + q * TEMPLATE_BYTES);
+        if (recognizer.rejects(best) != expected || (masked.letter == '?') != expected) reject_mismatches++;
+    }
+    if (config.threshold == loaded.letter_threshold_max && reject_mismatches == 0) {
+        std::cout << "✓ Recognizer applies the per-letter table" << std::endl;
+    } else {
+        std::cout << "✗ " << reject_mismatches << " per-letter rejections differ" << std::endl;
+        failures++;
+    }
+
+    // A 0° bank: rotated glyphs are turned like Recognizer does, so their
+    // genuine distances stay as low as the upright ones (templates are
+    // centred, as center_and_pack leaves them)
+    std::vector<Template> upright;
+    for (const Template& t : list) {
+        if (t.rotation != 0) continue;
+        upright.push_back(t);
+        center_bitplane(upright.back().bits.data(), upright.back().bits.data());
+    }
+    TemplateBank upright_bank(upright);
+    std::vector<uint8_t> turned(count * TEMPLATE_BYTES);
+    std::vector<char> turned_labels(count);
+    for (size_t q = 0; q < count; q++) {
+        const Template& t = upright[rng() % upright.size()];
+        rotate_bitplane(t.bits.data(), 90 * (rng() % 4), turned.data() + q * TEMPLATE_BYTES);
+        turned_labels[q] = t.letter;
+    }
+    ThresholdCalibration rotated = calibrate_threshold(upright_bank, turned.data(), turned_labels.data(), count, target_far);
+    std::cout << "0° bank, rotated glyphs: threshold " << rotated.threshold << ", FRR " << rotated.false_reject_rate << std::endl;
+    if (upright_bank.upright_only() && rotated.false_reject_rate < 0.05) {
+        std::cout << "✓ Rotated glyphs are calibrated in all four orientations" << std::endl;
+    } else {
+        std::cout << "✗ Rotated glyphs are rejected against a 0° bank" << std::endl;
+        failures++;
+    }
+
+    // Two letters sharing one shape: every impostor sits at distance 0
+    std::vector<Template> twins;
+    for (char letter : {'P', 'Q'}) {
+        Template t;
+        t.letter = letter;
+        t.rotation = 0;
+        t.bits = bases[0];
+        twins.push_back(t);
+    }
+    TemplateBank twin_bank(twins);
+    const char twin_labels[2] = {'P', 'Q'};
+    std::vector<uint8_t> twin_queries(2 * TEMPLATE_BYTES);
+    std::memcpy(twin_queries.data(), bases[0].data(), TEMPLATE_BYTES);
+    std::memcpy(twin_queries.data() + TEMPLATE_BYTES, bases[0].data(), TEMPLATE_BYTES);
+    ThresholdCalibration unattainable = calibrate_threshold(twin_bank, twin_queries.data(), twin_labels, 2, target_far);
+    RecognizerConfig reject_all;
+    use_threshold_calibration(reject_all, unattainable);
+    RecognitionResult twin_match = Recognizer(twins, reject_all).match(twin_queries.data());
+    if (unattainable.threshold == REJECT_ALL_THRESHOLD && unattainable.false_accept_rate == 0.0 &&
+        unattainable.false_reject_rate == 1.0 && unattainable.letter_threshold_max == REJECT_ALL_THRESHOLD &&
+        twin_match.letter == '?') {
+        std::cout << "✓ An unattainable target rejects every glyph (FAR 0, FRR 1)" << std::endl;
+    } else {
+        std::cout << "✗ Unattainable target: threshold " << unattainable.threshold << ", FAR "
+                  << unattainable.false_accept_rate << ", match '" << twin_match.letter << "'" << std::endl;
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
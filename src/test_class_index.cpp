@@ -0,0 +1,127 @@
+#include "recognizer.h"
+#include "trace.h"
+#include "test_shapes.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// Class index tests: matching class by class (prototype + triangle
+// inequality pruning) must return exactly the distances of the exhaustive
+// bounded scan, with and without early exit, and should skip most of a
+// bank that holds many samples per class. The index is built on first use,
+// which may happen on several threads at once.
+
+template<size_t K>
+static int compare(const Recognizer& indexed, const Recognizer& exhaustive, const std::vector<uint8_t>& queries) {
+    int mismatches = 0;
+    for (size_t q = 0; q < queries.size() / TEMPLATE_BYTES; q++) {
+        const uint8_t* query = queries.data() + q * TEMPLATE_BYTES;
+        auto a = indexed.match_top_k<K>(query);
+        auto b = exhaustive.match_top_k<K>(query);
+        for (size_t k = 0; k < K; k++) {
+            if (a[k].confidence != b[k].confidence) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main() {
+    std::cout << "=== Class Index Test ===" << std::endl;
+    std::mt19937 rng(20);
+    int failures = 0;
+
+    // 26 letters x 4 rotations, 20 noisy samples each
+    const int samples = 20;
+    std::vector<Template> bank;
+    std::vector<std::vector<uint8_t>> bases;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            std::vector<uint8_t> base(TEMPLATE_BYTES);
+            random_shape(rng, base.data());
+            for (int s = 0; s < samples; s++) {
+                Template t;
+                t.letter = letter;
+                t.rotation = rotation;
+                t.bits = base;
+                flip_bits(rng, t.bits.data(), 60);
+                bank.push_back(t);
+            }
+            bases.push_back(base);
+        }
+    }
+
+    const size_t count = 300;
+    std::vector<uint8_t> queries(count * TEMPLATE_BYTES);
+    for (size_t q = 0; q < count; q++) {
+        uint8_t* query = queries.data() + q * TEMPLATE_BYTES;
+        std::memcpy(query, bases[rng() % bases.size()].data(), TEMPLATE_BYTES);
+        flip_bits(rng, query, 80);
+    }
+
+    RecognizerConfig by_class, exhaustive;
+    by_class.class_index_min_class_size = 1;
+    exhaustive.class_index_min_class_size = SIZE_MAX;
+    Recognizer indexed(bank, by_class), plain(bank, exhaustive);
+
+    // First use races: every thread's first match needs the index
+    {
+        std::vector<int> thread_mismatches(4, 0);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_mismatches.size(); t++) {
+            threads.emplace_back([&, t] { thread_mismatches[t] = compare<1>(indexed, plain, queries); });
+        }
+        for (std::thread& thread : threads) thread.join();
+        int raced = 0;
+        for (int m : thread_mismatches) raced += m;
+        if (raced == 0) {
+            std::cout << "✓ Index built once under " << threads.size() << " concurrent first matches" << std::endl;
+        } else {
+            std::cout << "✗ " << raced << " distances differ after a concurrent first build" << std::endl;
+            failures++;
+        }
+    }
+    std::cout << "Bank: " << indexed.bank().size() << " templates in " << indexed.bank().class_count() << " classes" << std::endl;
+
+    int mismatches = compare<1>(indexed, plain, queries) + compare<5>(indexed, plain, queries);
+    RecognizerConfig early = by_class, early_plain = exhaustive;
+    early.early_exit_at_threshold = early_plain.early_exit_at_threshold = true;
+    early.threshold = early_plain.threshold = 150;
+    mismatches += compare<3>(Recognizer(bank, early), Recognizer(bank, early_plain), queries);
+    if (mismatches == 0) {
+        std::cout << "✓ " << count << " queries: class-pruned distances identical to the exhaustive scan" << std::endl;
+    } else {
+        std::cout << "✗ " << mismatches << " distances differ from the exhaustive scan" << std::endl;
+        failures++;
+    }
+
+    // Pruning rate, through the trace counters
+    set_trace_level(TraceLevel::Counters);
+    trace_counters().reset();
+    for (size_t q = 0; q < count; q++) indexed.match(queries.data() + q * TEMPLATE_BYTES);
+    const TraceCounters& c = trace_counters();
+    double rate = 100.0 * c.class_pruned.load() / c.templates_compared.load();
+    std::cout << "Pruned by class prototype: " << c.class_pruned.load() << "/" << c.templates_compared.load()
+              << " templates (" << rate << "%), " << c.classes_pruned.load() << " whole classes" << std::endl;
+    set_trace_level(TraceLevel::Off);
+    if (rate < 50) {
+        std::cout << "✗ the class index prunes less than half the bank" << std::endl;
+        failures++;
+    }
+
+    // Rough timing
+    for (int pass = 0; pass < 2; pass++) {
+        const Recognizer& recognizer = pass == 0 ? plain : indexed;
+        auto start = std::chrono::steady_clock::now();
+        int checksum = 0;
+        for (int r = 0; r < 5; r++) {
+            for (size_t q = 0; q < count; q++) checksum += recognizer.match(queries.data() + q * TEMPLATE_BYTES).confidence;
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (pass == 0 ? "Exhaustive: " : "By class:   ") << us / (5.0 * count) << " us/query"
+                  << " (checksum " << checksum << ")" << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "letter_recognition.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Equivalence tests for the vectorized preprocessing: preprocess_glyph must
+// produce exactly the bits of resize + adaptive_binarize +
+// center_and_pack_reference (preprocess_glyph_reference), and the SIMD
+// center_and_pack exactly those of its pixel-by-pixel reference, for any
+// input and with reused output buffers.
+
+static cv::Mat random_glyph(std::mt19937& rng) {
+    int rows = 16 + rng() % 200, cols = 16 + rng() % 200;
+    if (rng() % 4 == 0) rows = cols = 64;  // Board cells arrive at 64x64
+    cv::Mat img(rows, cols, CV_8UC3);
+    uint8_t background = rng() % 256;
+    for (int y = 0; y < rows; y++) {
+        uint8_t* row = img.ptr<uint8_t>(y);
+        for (int i = 0; i < cols * 3; i++) row[i] = background + (rng() % 21) - 10;
+    }
+    // A few strokes in a contrasting shade
+    uint8_t ink = background + 128;
+    for (int s = 0, strokes = rng() % 4; s < strokes; s++) {
+        int x0 = rng() % cols, y0 = rng() % rows;
+        int w = 1 + rng() % (cols / 2), h = 1 + rng() % (rows / 2);
+        for (int y = y0; y < std::min(rows, y0 + h); y++) {
+            uint8_t* row = img.ptr<uint8_t>(y);
+            for (int x = x0; x < std::min(cols, x0 + w); x++) {
+                row[x * 3] = ink; row[x * 3 + 1] = ink + 7; row[x * 3 + 2] = ink - 7;
+            }
+        }
+    }
+    return img;
+}
+
+int main() {
+    std::cout << "=== Fused Preprocessing Equivalence Test ===" << std::endl;
+
+    std::mt19937 rng(2024);
+    const int cases = 2000;
+    std::vector<cv::Mat> glyphs;
+    for (int i = 0; i < cases; i++) glyphs.push_back(random_glyph(rng));
+    // Edge cases: blank, solid and single-pixel glyphs
+    glyphs.push_back(cv::Mat(64, 64, CV_8UC3, cv::Scalar(255, 255, 255)));
+    glyphs.push_back(cv::Mat(64, 64, CV_8UC3, cv::Scalar(0, 0, 0)));
+    cv::Mat dot(64, 64, CV_8UC3, cv::Scalar(255, 255, 255));
+    dot.ptr<uint8_t>(0)[0] = dot.ptr<uint8_t>(0)[1] = dot.ptr<uint8_t>(0)[2] = 0;
+    glyphs.push_back(dot);
+
+    GlyphScratch scratch;
+    uint8_t fused[TEMPLATE_BYTES], reference[TEMPLATE_BYTES];
+    int mismatches = 0;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        // Stale bytes must not leak into either result
+        std::memset(fused, 0xA5, sizeof(fused));
+        std::memset(reference, 0x5A, sizeof(reference));
+        preprocess_glyph(glyphs[i], scratch, fused);
+        preprocess_glyph_reference(glyphs[i], scratch, reference);
+        if (std::memcmp(fused, reference, TEMPLATE_BYTES) != 0) {
+            if (mismatches < 5) {
+                std::cout << "✗ Mismatch on glyph " << i << " (" << glyphs[i].cols << "x" << glyphs[i].rows
+                          << "), hamming distance " << hamming_distance(fused, reference) << std::endl;
+            }
+            mismatches++;
+        }
+    }
+
+    if (mismatches == 0) {
+        std::cout << "✓ " << glyphs.size() << " glyphs: fused output identical to the reference" << std::endl;
+    } else {
+        std::cout << "✗ " << mismatches << "/" << glyphs.size() << " glyphs differ" << std::endl;
+    }
+
+    // center_and_pack on binary images, one output buffer reused throughout
+    // (a stale set bit from the previous glyph must not survive)
+    std::vector<uint8_t> packed, packed_reference;
+    int pack_mismatches = 0;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        cv::Mat resized, binary;
+        cv::resize(glyphs[i], resized, cv::Size(64, 64));
+        adaptive_binarize(resized, binary);
+        center_and_pack(binary, packed);
+        center_and_pack_reference(binary, packed_reference);
+        if (packed != packed_reference) pack_mismatches++;
+    }
+    if (pack_mismatches == 0) {
+        std::cout << "✓ " << glyphs.size() << " binary images: center_and_pack identical to the reference" << std::endl;
+    } else {
+        std::cout << "✗ " << pack_mismatches << "/" << glyphs.size() << " binary images differ in center_and_pack" << std::endl;
+    }
+    mismatches += pack_mismatches;
+
+    // Rough timing of both paths on the same glyphs
+    for (int fused_path = 0; fused_path < 2; fused_path++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < 5; r++) {
+            for (const cv::Mat& glyph : glyphs) {
+                if (fused_path) preprocess_glyph(glyph, scratch, fused);
+                else preprocess_glyph_reference(glyph, scratch, reference);
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (fused_path ? "Fused:     " : "Reference: ") << us / (5.0 * glyphs.size()) << " us/glyph" << std::endl;
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include "letter_recognition.h"
+#include "trace.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -10,6 +11,9 @@
 int main() {
     std::cout << "=== Letter Recognition Test ===" << std::endl;
     
+    // Show per-call diagnostics (distances, top matches)
+    set_trace_level(TraceLevel::Text);
+    
     // Load templates
     try {
         load_templates_binary("templates.bin");
@@ -0,0 +1,220 @@
+#include "recognition_client.h"
+#include "recognition_server.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Daemon tests: an in-process RecognitionServer must answer tiles exactly
+// like the Recognizer it serves (top-1 and top-K), coalesce concurrent
+// clients into batches, report malformed requests, and switch banks on a
+// reload command.
+
+// A gray tile of a few dark rectangles on a light background
+static std::vector<uint8_t> random_tile(std::mt19937& rng) {
+    std::vector<uint8_t> pixels(RECOGNIZED_TILE_BYTES, 210);
+    for (int r = 0; r < 4; r++) {
+        int x0 = 4 + rng() % 36, y0 = 4 + rng() % 36;
+        int w = 6 + rng() % 18, h = 6 + rng() % 18;
+        for (int y = y0; y < y0 + h; y++) {
+            for (int x = x0; x < x0 + w; x++) pixels[y * RECOGNIZED_TILE_SIZE + x] = 40;
+        }
+    }
+    return pixels;
+}
+
+// A copy of a tile with some pixels flipped
+static void noisy_copy(std::mt19937& rng, const std::vector<uint8_t>& tile, uint8_t* pixels) {
+    for (size_t i = 0; i < RECOGNIZED_TILE_BYTES; i++) {
+        pixels[i] = rng() % 25 == 0 ? 250 - tile[i] : tile[i];
+    }
+}
+
+// One template per (letter, rotation), packed from a clean tile the way
+// template_generator packs its images
+static std::vector<Template> make_templates(std::mt19937& rng, char first, char last,
+                                            std::vector<std::vector<uint8_t>>& tiles) {
+    std::vector<Template> list;
+    GlyphScratch scratch;
+    tiles.clear();
+    for (char letter = first; letter <= last; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            tiles.push_back(random_tile(rng));
+            cv::Mat tile(RECOGNIZED_TILE_SIZE, RECOGNIZED_TILE_SIZE, CV_8UC1, tiles.back().data());
+            Template t;
+            t.letter = letter;
+            t.rotation = rotation;
+            t.bits.resize(TEMPLATE_BYTES);
+            preprocess_glyph(tile, scratch, t.bits.data());
+            list.push_back(t);
+        }
+    }
+    return list;
+}
+
+// Status of a request of an unknown kind, sent by hand (the client API
+// cannot produce one)
+static RecognizedStatus unknown_kind_status(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    uint8_t bytes[RECOGNIZED_HEADER_BYTES];
+    RecognizedRequestHeader request;
+    request.id = 7;
+    request.kind = static_cast<RecognizedKind>(7);
+    request.write(bytes);
+    RecognizedResponseHeader response;
+    response.status = RecognizedStatus::Ok;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+        write(fd, bytes, sizeof(bytes)) == static_cast<ssize_t>(sizeof(bytes)) &&
+        recv(fd, bytes, sizeof(bytes), MSG_WAITALL) == static_cast<ssize_t>(sizeof(bytes))) {
+        response.read(bytes);
+    }
+    close(fd);
+    return response.id == 7 ? response.status : RecognizedStatus::Ok;
+}
+
+static bool same(const RecognizedMatch& a, const RecognitionResult& b) {
+    return a.letter == b.letter && a.rotation == b.rotation && a.distance == b.confidence;
+}
+
+int main() {
+    std::cout << "=== Recognition Daemon Test ===" << std::endl;
+    std::mt19937 rng(25);
+    int failures = 0;
+
+    std::vector<std::vector<uint8_t>> clean;
+    std::vector<Template> list = make_templates(rng, 'A', 'Z', clean);
+    const std::string bank_path = "test_recognized.bank";
+    TemplateBank(list).save(bank_path);
+    RecognizerConfig config;
+    config.threshold = 250;  // Some tiles are rejected, some accepted
+    ReloadableRecognizer reloadable(bank_path, config);
+    std::shared_ptr<const Recognizer> direct = reloadable.snapshot();
+
+    // Tiles of random templates
+    const size_t tiles_per_client = 300;
+    const int clients = 4;
+    std::vector<uint8_t> pixels(clients * tiles_per_client * RECOGNIZED_TILE_BYTES);
+    for (size_t t = 0; t < clients * tiles_per_client; t++) {
+        noisy_copy(rng, clean[rng() % clean.size()], pixels.data() + t * RECOGNIZED_TILE_BYTES);
+    }
+
+    RecognitionServerConfig server_config;
+    server_config.socket_path = "/tmp/test_recognized_" + std::to_string(getpid()) + ".sock";
+    server_config.max_batch = 32;
+    server_config.max_wait_us = 500;
+    RecognitionServer server(reloadable, server_config);
+    server.start();
+
+    // Concurrent clients, pipelined tiles
+    std::vector<std::vector<RecognizedReply>> replies(clients);
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c] {
+            RecognitionClient client(server_config.socket_path);
+            replies[c] = client.recognize_tiles(pixels.data() + c * tiles_per_client * RECOGNIZED_TILE_BYTES,
+                                                tiles_per_client);
+        });
+    }
+    for (std::thread& t : threads) t.join();
+
+    int mismatches = 0, rejected = 0;
+    for (int c = 0; c < clients; c++) {
+        for (size_t t = 0; t < tiles_per_client; t++) {
+            const uint8_t* tile_pixels = pixels.data() + (c * tiles_per_client + t) * RECOGNIZED_TILE_BYTES;
+            cv::Mat tile(RECOGNIZED_TILE_SIZE, RECOGNIZED_TILE_SIZE, CV_8UC1, const_cast<uint8_t*>(tile_pixels));
+            RecognitionResult expected = direct->recognize(tile);
+            const RecognizedReply& reply = replies[c][t];
+            if (reply.status != RecognizedStatus::Ok || reply.matches.size() != 1 || !same(reply.matches[0], expected)) {
+                mismatches++;
+            }
+            rejected += expected.letter == '?';
+        }
+    }
+    RecognitionServer::Stats stats = server.stats();
+    double mean_batch = stats.batches ? static_cast<double>(stats.batched_glyphs) / stats.batches : 0.0;
+    if (mismatches == 0) {
+        std::cout << "✓ " << clients * tiles_per_client << " tiles from " << clients
+                  << " clients match the Recognizer (" << rejected << " rejected)" << std::endl;
+    } else {
+        std::cout << "✗ " << mismatches << " daemon replies differ from the Recognizer" << std::endl;
+        failures++;
+    }
+    if (mean_batch > 1.5) {
+        std::cout << "✓ Requests were batched: " << stats.batches << " batches, mean " << mean_batch << " glyphs"
+                  << std::endl;
+    } else {
+        std::cout << "✗ Requests were not batched (mean " << mean_batch << " glyphs)" << std::endl;
+        failures++;
+    }
+
+    RecognitionClient client(server_config.socket_path);
+
+    // Top-K lists are the unmasked recognize_top_k ones
+    int top_mismatches = 0;
+    for (size_t t = 0; t < 50; t++) {
+        const uint8_t* tile_pixels = pixels.data() + t * RECOGNIZED_TILE_BYTES;
+        cv::Mat tile(RECOGNIZED_TILE_SIZE, RECOGNIZED_TILE_SIZE, CV_8UC1, const_cast<uint8_t*>(tile_pixels));
+        std::array<RecognitionResult, 5> expected = direct->recognize_top_k<5>(tile);
+        RecognizedReply reply = client.recognize_tile(tile_pixels, 4);
+        bool ok = reply.status == RecognizedStatus::Ok && reply.matches.size() == 4;
+        for (size_t k = 0; ok && k < 4; k++) ok = same(reply.matches[k], expected[k]);
+        top_mismatches += !ok;
+    }
+    if (top_mismatches == 0) {
+        std::cout << "✓ Top-4 lists match recognize_top_k" << std::endl;
+    } else {
+        std::cout << "✗ " << top_mismatches << " top-4 lists differ" << std::endl;
+        failures++;
+    }
+
+    // Malformed requests get a status, and the connection stays usable
+    const char garbage[] = "not an image";
+    RecognizedReply bad_image = client.recognize_image(garbage, sizeof(garbage));
+    RecognizedStatus bad_kind = unknown_kind_status(server_config.socket_path);
+    RecognizedReply after = client.recognize_tile(pixels.data());
+    if (bad_image.status == RecognizedStatus::DecodeFailed && bad_kind == RecognizedStatus::BadRequest &&
+        after.status == RecognizedStatus::Ok) {
+        std::cout << "✓ Undecodable and malformed requests are reported" << std::endl;
+    } else {
+        std::cout << "✗ Malformed requests were not reported" << std::endl;
+        failures++;
+    }
+
+    // Reload command: a new template set is served once it is published
+    std::vector<Template> other = make_templates(rng, 'a', 'z', clean);
+    TemplateBank(other).save(bank_path);
+    uint32_t before = client.reload();
+    bool switched = false;
+    for (int attempt = 0; attempt < 500 && !switched; attempt++) {
+        RecognizedReply reply = client.recognize_tile(pixels.data(), 2);
+        switched = reply.generation > before && reply.matches[0].letter >= 'a' && reply.matches[0].letter <= 'z';
+        if (!switched) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (switched) {
+        std::cout << "✓ Reload command switches to the new templates" << std::endl;
+    } else {
+        std::cout << "✗ Still serving the old templates after a reload" << std::endl;
+        failures++;
+    }
+
+    server.stop();
+    reloadable.stop();
+    std::remove(bank_path.c_str());
+    bool socket_removed = access(server_config.socket_path.c_str(), F_OK) != 0;
+    if (socket_removed) {
+        std::cout << "✓ Socket removed on stop" << std::endl;
+    } else {
+        std::cout << "✗ Socket file left behind" << std::endl;
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+#include "reloadable_recognizer.h"
+#include "test_shapes.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// Hot reload tests: a reload publishes a new bank without disturbing
+// snapshots taken before it, a broken file keeps the current bank, the
+// watcher picks up a replaced file, and readers running through many
+// reloads (of a ReloadableRecognizer and of the global bank) always match
+// against one whole bank.
+
+// Noisy copies of one shape, all labelled `letter`
+static std::vector<Template> letter_templates(std::mt19937& rng, char letter, size_t count) {
+    std::vector<uint8_t> base(TEMPLATE_BYTES);
+    random_shape(rng, base.data());
+    std::vector<Template> list(count);
+    for (Template& t : list) {
+        t.letter = letter;
+        t.rotation = 0;
+        t.bits = base;
+        flip_bits(rng, t.bits.data(), 40);
+    }
+    return list;
+}
+
+static bool wait_for_generation(const ReloadableRecognizer& reloadable, uint64_t generation) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (reloadable.generation() < generation) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "=== Hot Reload Test ===" << std::endl;
+    std::mt19937 rng(24);
+    int failures = 0;
+
+    std::vector<Template> list_a = letter_templates(rng, 'A', 300);
+    std::vector<Template> list_b = letter_templates(rng, 'B', 300);
+    std::vector<Template> list_c = letter_templates(rng, 'C', 300);
+    std::vector<uint8_t> query(list_a[0].bits);
+
+    RecognizerConfig config;
+    config.threshold = INT_MAX;  // Every match is accepted; the letter tells the bank
+    const std::string path = "test_reload.bank";
+    TemplateBank(list_a).save(path);
+    ReloadableRecognizer reloadable(path, config);
+
+    // Reload under a held snapshot
+    std::shared_ptr<const Recognizer> old = reloadable.snapshot();
+    TemplateBank(list_b).save(path);
+    bool reloaded = reloadable.reload();
+    std::shared_ptr<const Recognizer> fresh = reloadable.snapshot();
+    if (reloaded && reloadable.generation() == 2 && fresh->match(query.data()).letter == 'B' &&
+        old->match(query.data()).letter == 'A' && old->bank().verify()) {
+        std::cout << "✓ Reload publishes the new bank; an older snapshot keeps its own" << std::endl;
+    } else {
+        std::cout << "✗ Reload did not swap cleanly (generation " << reloadable.generation() << ")" << std::endl;
+        failures++;
+    }
+    old.reset();
+
+    // A broken file is refused (put in place by rename: a mapped bank file
+    // must never be rewritten in place)
+    {
+        std::ofstream broken(path + ".tmp", std::ios::binary | std::ios::trunc);
+        broken << "LRTB not really a bank";
+    }
+    std::rename((path + ".tmp").c_str(), path.c_str());
+    bool refused = !reloadable.reload();
+    if (refused && reloadable.generation() == 2 && reloadable.snapshot()->match(query.data()).letter == 'B') {
+        std::cout << "✓ A broken file keeps the current bank" << std::endl;
+    } else {
+        std::cout << "✗ A broken file replaced the bank" << std::endl;
+        failures++;
+    }
+
+    // The watcher sees an atomic replacement, and the reload command works
+    reloadable.watch(50);
+    TemplateBank(list_c).save(path);
+    bool watched = wait_for_generation(reloadable, 3) && reloadable.snapshot()->match(query.data()).letter == 'C';
+    reloadable.request_reload();
+    bool commanded = wait_for_generation(reloadable, 4);
+    reloadable.stop();
+    if (watched && commanded) {
+        std::cout << "✓ Watcher reloads a replaced file; request_reload reloads on demand" << std::endl;
+    } else {
+        std::cout << "✗ Watcher " << (watched ? "ok" : "missed the change") << ", request "
+                  << (commanded ? "ok" : "ignored") << std::endl;
+        failures++;
+    }
+
+    // Readers against a stream of reloads: each result must come from the
+    // bank of the snapshot it was matched on, and the snapshot's generation
+    // must name that bank (C before the loop, then B, A, B, ...)
+    const int readers = 4, reloads = 40;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> matches(0), torn(0);
+    std::vector<std::thread> threads;
+    uint64_t start_generation = reloadable.generation();
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&] {
+            while (!done.load()) {
+                ReloadableRecognizer::VersionedSnapshot snapshot = reloadable.versioned_snapshot();
+                uint64_t reloaded = snapshot.generation - start_generation;
+                char expected = reloaded == 0 ? 'C' : reloaded % 2 ? 'B' : 'A';
+                if (snapshot.recognizer->match(query.data()).letter != expected ||
+                    snapshot.recognizer->bank().letter(0) != expected) {
+                    torn++;
+                }
+                Recognizer global = default_recognizer();  // Unmasked: SAFE_THRESHOLD applies here
+                if (!global.bank().empty() && global.match_top_k<1>(query.data())[0].letter != global.bank().letter(0)) {
+                    torn++;
+                }
+                matches++;
+            }
+        });
+    }
+    for (int i = 0; i < reloads; i++) {
+        const std::vector<Template>& list = i % 2 ? list_a : list_b;
+        TemplateBank(list).save(path);
+        reloadable.reload();
+        if (i % 2) {
+            load_template_bank(path);
+        } else {
+            templates = list;
+            rebuild_template_bank();
+        }
+    }
+    done = true;
+    for (std::thread& t : threads) t.join();
+    std::remove(path.c_str());
+    if (torn == 0 && reloadable.generation() == start_generation + reloads) {
+        std::cout << "✓ " << matches << " concurrent matches across " << reloads << " reloads, all consistent" << std::endl;
+    } else {
+        std::cout << "✗ " << torn << " of " << matches << " concurrent matches saw a mixed bank" << std::endl;
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+#include "recognizer.h"
+#include "test_shapes.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Query-rotation tests: rotate_bitplane must match a pixel-by-pixel
+// rotation, a rotated glyph turned back must pack like the upright one,
+// and matching turned queries against a 0° bank must agree with a brute
+// force search.
+
+// Clockwise, like rotation.py: pixel (x, y) of the result comes from
+// (y, 63 - x) for 90°, and so on
+static void rotate_reference(const uint8_t* src, int degrees, uint8_t* dst) {
+    const int last = TEMPLATE_SIZE - 1;
+    std::memset(dst, 0, TEMPLATE_BYTES);
+    for (int y = 0; y < TEMPLATE_SIZE; y++) {
+        for (int x = 0; x < TEMPLATE_SIZE; x++) {
+            bool bit = degrees == 90  ? get_bit(src, y, last - x)
+                     : degrees == 180 ? get_bit(src, last - x, last - y)
+                     : degrees == 270 ? get_bit(src, last - y, x)
+                     : get_bit(src, x, y);
+            if (bit) set_bit(dst, x, y);
+        }
+    }
+}
+
+static void random_bits(std::mt19937& rng, uint8_t* bits) {
+    for (size_t i = 0; i < TEMPLATE_BYTES; i++) bits[i] = static_cast<uint8_t>(rng());
+}
+
+int main() {
+    std::cout << "=== Query Rotation Test ===" << std::endl;
+    std::mt19937 rng(18);
+    int failures = 0;
+
+    // Bitplane rotations against the pixel loop
+    uint8_t src[TEMPLATE_BYTES], fast[TEMPLATE_BYTES], reference[TEMPLATE_BYTES], transposed[TEMPLATE_BYTES];
+    int rotation_mismatches = 0;
+    for (int i = 0; i < 200; i++) {
+        random_bits(rng, src);
+        for (int degrees : {0, 90, 180, 270}) {
+            rotate_bitplane(src, degrees, fast);
+            rotate_reference(src, degrees, reference);
+            if (std::memcmp(fast, reference, TEMPLATE_BYTES) != 0) rotation_mismatches++;
+        }
+        transpose_bitplane(src, transposed);
+        for (int y = 0; y < TEMPLATE_SIZE; y++) {
+            for (int x = 0; x < TEMPLATE_SIZE; x++) {
+                if (get_bit(transposed, x, y) != get_bit(src, y, x)) {
+                    rotation_mismatches++;
+                    x = y = TEMPLATE_SIZE;
+                }
+            }
+        }
+        // In place
+        std::memcpy(fast, src, TEMPLATE_BYTES);
+        rotate_bitplane(fast, 90, fast);
+        rotate_reference(src, 90, reference);
+        if (std::memcmp(fast, reference, TEMPLATE_BYTES) != 0) rotation_mismatches++;
+    }
+    if (rotation_mismatches == 0) {
+        std::cout << "✓ rotate_bitplane / transpose_bitplane match the pixel loop" << std::endl;
+    } else {
+        std::cout << "✗ " << rotation_mismatches << " bitplane rotation mismatches" << std::endl;
+        failures++;
+    }
+
+    // Turned queries against a brute-force search over the 0° bank
+    std::vector<Template> upright;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int v = 0; v < 3; v++) {
+            Template t;
+            t.letter = letter;
+            t.rotation = 0;
+            t.bits.resize(TEMPLATE_BYTES);
+            random_bits(rng, t.bits.data());
+            center_bitplane(t.bits.data(), t.bits.data());
+            upright.push_back(t);
+        }
+    }
+    Recognizer recognizer(upright);
+    RecognizerConfig stored;
+    stored.rotation_search = RotationSearch::Templates;
+    if (!recognizer.rotates_queries() || Recognizer(upright, stored).rotates_queries()) {
+        std::cout << "✗ RotationSearch picked the wrong mode" << std::endl;
+        failures++;
+    }
+
+    // Queries: a template turned clockwise with a few hundred bits flipped
+    const size_t count = 300;
+    std::vector<uint8_t> queries(count * TEMPLATE_BYTES);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t* query = queries.data() + i * TEMPLATE_BYTES;
+        rotate_bitplane(upright[rng() % upright.size()].bits.data(), 90 * (rng() % 4), query);
+        for (int f = 0; f < 300; f++) {
+            int bit = rng() % (TEMPLATE_SIZE * TEMPLATE_SIZE);
+            query[bit / 8] ^= 1 << (bit % 8);
+        }
+    }
+
+    int match_mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* query = queries.data() + i * TEMPLATE_BYTES;
+        RecognitionResult expected;
+        for (int degrees : {0, 90, 180, 270}) {
+            uint8_t turned[TEMPLATE_BYTES];
+            rotate_bitplane(query, (360 - degrees) % 360, turned);
+            if (degrees != 0) center_bitplane(turned, turned);
+            for (const Template& t : upright) {
+                int d = hamming_distance(turned, t.bits.data());
+                if (d < expected.confidence) expected = RecognitionResult(t.letter, degrees, d);
+            }
+        }
+        RecognitionResult got = recognizer.match_top_k<1>(query)[0];
+        if (!same(got, expected)) match_mismatches++;
+    }
+    if (match_mismatches == 0) {
+        std::cout << "✓ " << count << " queries: turned-query search matches brute force" << std::endl;
+    } else {
+        std::cout << "✗ " << match_mismatches << "/" << count << " queries differ from brute force" << std::endl;
+        failures++;
+    }
+
+    // A glyph image rotated by whole pixels, preprocessed and turned back,
+    // should land close to the upright glyph's bits. Only the border rows
+    // and columns the centring shift clipped can differ, and re-centring
+    // must remove the one-pixel offset a plain quarter turn leaves.
+    std::vector<cv::Mat> glyphs;
+    long turned_distance = 0, recentred_distance = 0;
+    for (int i = 0; i < 100; i++) {
+        cv::Mat glyph(TEMPLATE_SIZE, TEMPLATE_SIZE, CV_8UC3, cv::Scalar(0, 0, 0));
+        for (int s = 0; s < 3; s++) {
+            int x0 = 12 + rng() % 30, y0 = 12 + rng() % 30;
+            int w = 2 + rng() % 12, h = 2 + rng() % 12;
+            for (int y = y0; y < y0 + h; y++) {
+                for (int x = x0; x < x0 + w; x++) {
+                    uint8_t* pixel = glyph.ptr<uint8_t>(y) + x * 3;
+                    pixel[0] = pixel[1] = pixel[2] = 255;
+                }
+            }
+        }
+        uint8_t upright_bits[TEMPLATE_BYTES];
+        GlyphScratch scratch;
+        preprocess_glyph(glyph, scratch, upright_bits);
+        for (int degrees : {90, 180, 270}) {
+            cv::Mat turned_image(TEMPLATE_SIZE, TEMPLATE_SIZE, CV_8UC3);
+            const int last = TEMPLATE_SIZE - 1;
+            for (int y = 0; y < TEMPLATE_SIZE; y++) {
+                for (int x = 0; x < TEMPLATE_SIZE; x++) {
+                    int sx = degrees == 90 ? y : degrees == 180 ? last - x : last - y;
+                    int sy = degrees == 90 ? last - x : degrees == 180 ? last - y : x;
+                    std::memcpy(turned_image.ptr<uint8_t>(y) + x * 3, glyph.ptr<uint8_t>(sy) + sx * 3, 3);
+                }
+            }
+            uint8_t turned[TEMPLATE_BYTES], recentred[TEMPLATE_BYTES];
+            preprocess_glyph(turned_image, scratch, turned);
+            rotate_bitplane(turned, 360 - degrees, turned);
+            center_bitplane(turned, recentred);
+            turned_distance += hamming_distance(turned, upright_bits);
+            recentred_distance += hamming_distance(recentred, upright_bits);
+            glyphs.push_back(turned_image);
+        }
+    }
+    std::cout << "Rotated glyphs turned back, mean distance to upright: " << turned_distance / 300.0
+              << " (turn only), " << recentred_distance / 300.0 << " (re-centred)" << std::endl;
+    if (recentred_distance * 2 < turned_distance) {
+        std::cout << "✓ re-centring halves the distance of turned-back glyphs" << std::endl;
+    } else {
+        std::cout << "✗ re-centring does not bring turned-back glyphs closer" << std::endl;
+        failures++;
+    }
+
+    // Batched path agrees with the single-glyph one
+    std::vector<RecognitionResult> batched = recognizer.recognize_all(glyphs);
+    int batch_mismatches = 0;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        if (!same(batched[i], recognizer.recognize(glyphs[i]))) batch_mismatches++;
+    }
+    if (batch_mismatches == 0) {
+        std::cout << "✓ " << glyphs.size() << " glyphs: recognize_all agrees with recognize" << std::endl;
+    } else {
+        std::cout << "✗ " << batch_mismatches << " recognize_all mismatches" << std::endl;
+        failures++;
+    }
+
+    // Also where match() takes the coarse-to-fine shortlist
+    RecognizerConfig coarse;
+    coarse.coarse_to_fine_min_templates = 1;
+    Recognizer coarse_recognizer(upright, coarse);
+    std::vector<RecognitionResult> coarse_batched = coarse_recognizer.recognize_all(glyphs);
+    int coarse_mismatches = 0;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        if (!same(coarse_batched[i], coarse_recognizer.recognize(glyphs[i]))) coarse_mismatches++;
+        if (!same(coarse_recognizer.recognize_top_k<2>(glyphs[i])[0],
+                  coarse_recognizer.recognize_top_k<1>(glyphs[i])[0])) coarse_mismatches++;
+    }
+    if (coarse_mismatches == 0) {
+        std::cout << "✓ coarse-to-fine: recognize_all and top-2 agree with recognize" << std::endl;
+    } else {
+        std::cout << "✗ " << coarse_mismatches << " coarse-to-fine mismatches" << std::endl;
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
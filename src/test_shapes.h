@@ -0,0 +1,46 @@
+#pragma once
+#include "letter_recognition.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+// Synthetic bitplanes and small helpers shared by the matching tests
+
+inline bool get_bit(const uint8_t* bits, int x, int y) {
+    int pos = y * TEMPLATE_SIZE + x;
+    return (bits[pos / 8] >> (pos % 8)) & 1;
+}
+
+inline void set_bit(uint8_t* bits, int x, int y) {
+    int pos = y * TEMPLATE_SIZE + x;
+    bits[pos / 8] |= 1 << (pos % 8);
+}
+
+// Letter, rotation and distance all equal
+inline bool same(const RecognitionResult& a, const RecognitionResult& b) {
+    return a.letter == b.letter && a.rotation == b.rotation && a.confidence == b.confidence;
+}
+
+// A few filled rectangles (clipped to the tile), so noisy copies of one
+// shape look alike the way samples of one glyph do
+inline void random_shape(std::mt19937& rng, uint8_t* bits) {
+    std::memset(bits, 0, TEMPLATE_BYTES);
+    for (int r = 0; r < 4; r++) {
+        int x0 = 4 + rng() % 40, y0 = 4 + rng() % 40;
+        int w = 6 + rng() % 18, h = 6 + rng() % 18;
+        for (int y = y0; y < std::min(y0 + h, TEMPLATE_SIZE); y++) {
+            for (int x = x0; x < std::min(x0 + w, TEMPLATE_SIZE); x++) {
+                int pos = y * TEMPLATE_SIZE + x;
+                bits[pos / 8] |= 1 << (pos % 8);
+            }
+        }
+    }
+}
+
+// Flips count random bits (a bit may flip more than once)
+inline void flip_bits(std::mt19937& rng, uint8_t* bits, int count) {
+    for (int f = 0; f < count; f++) {
+        int bit = rng() % (TEMPLATE_SIZE * TEMPLATE_SIZE);
+        bits[bit / 8] ^= 1 << (bit % 8);
+    }
+}
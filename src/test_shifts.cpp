@@ -0,0 +1,145 @@
+#include "recognizer.h"
+#include "test_shapes.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Shift-tolerant matching tests: shift_bitplane must match a pixel loop,
+// the shifted search must find each template's best offset exactly like a
+// brute force search, and glyphs knocked off-centre by a pixel or two must
+// be matched at (close to) their unshifted distance.
+
+static void random_bits(std::mt19937& rng, uint8_t* bits) {
+    for (size_t i = 0; i < TEMPLATE_BYTES; i++) bits[i] = static_cast<uint8_t>(rng() & rng());
+}
+
+int main() {
+    std::cout << "=== Shift-Tolerant Matching Test ===" << std::endl;
+    std::mt19937 rng(19);
+    int failures = 0;
+
+    // shift_bitplane against the pixel loop
+    uint8_t src[TEMPLATE_BYTES], shifted[TEMPLATE_BYTES];
+    int shift_mismatches = 0;
+    for (int i = 0; i < 50; i++) {
+        random_bits(rng, src);
+        for (int dy = -3; dy <= 3; dy++) {
+            for (int dx = -3; dx <= 3; dx++) {
+                shift_bitplane(src, dx, dy, shifted);
+                for (int y = 0; y < TEMPLATE_SIZE; y++) {
+                    for (int x = 0; x < TEMPLATE_SIZE; x++) {
+                        int sx = x - dx, sy = y - dy;
+                        bool expected = sx >= 0 && sx < TEMPLATE_SIZE && sy >= 0 && sy < TEMPLATE_SIZE && get_bit(src, sx, sy);
+                        if (get_bit(shifted, x, y) != expected) shift_mismatches++;
+                    }
+                }
+            }
+        }
+    }
+    uint8_t copies[MAX_SHIFTED_QUERIES * TEMPLATE_BYTES];
+    size_t n = shifted_queries(src, 2, copies);
+    if (n != 25 || std::memcmp(copies, src, TEMPLATE_BYTES) != 0) shift_mismatches++;
+    if (shifted_queries(src, 10, copies) != MAX_SHIFTED_QUERIES) shift_mismatches++;
+    if (shift_mismatches == 0) {
+        std::cout << "✓ shift_bitplane / shifted_queries match the pixel loop" << std::endl;
+    } else {
+        std::cout << "✗ " << shift_mismatches << " shifted pixel mismatches" << std::endl;
+        failures++;
+    }
+
+    std::vector<Template> bank;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            Template t;
+            t.letter = letter;
+            t.rotation = rotation;
+            t.bits.resize(TEMPLATE_BYTES);
+            random_shape(rng, t.bits.data());
+            bank.push_back(t);
+        }
+    }
+
+    // Queries: a template off by up to 2 pixels, plus noise
+    const size_t count = 200;
+    std::vector<uint8_t> queries(count * TEMPLATE_BYTES);
+    std::vector<size_t> sources(count);
+    for (size_t i = 0; i < count; i++) {
+        sources[i] = rng() % bank.size();
+        int dx = static_cast<int>(rng() % 5) - 2, dy = static_cast<int>(rng() % 5) - 2;
+        uint8_t* query = queries.data() + i * TEMPLATE_BYTES;
+        shift_bitplane(bank[sources[i]].bits.data(), dx, dy, query);
+        flip_bits(rng, query, 100);
+    }
+
+    // Shifted search against brute force over every offset and template
+    for (int radius = 1; radius <= 2; radius++) {
+        RecognizerConfig config;
+        config.shift_radius = radius;
+        Recognizer recognizer(bank, config);
+        int mismatches = 0;
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t* query = queries.data() + i * TEMPLATE_BYTES;
+            size_t copies_count = shifted_queries(query, radius, copies);
+            RecognitionResult expected;
+            for (const Template& t : bank) {
+                int best = INT_MAX;
+                for (size_t s = 0; s < copies_count; s++) {
+                    best = std::min<int>(best, hamming_distance(copies + s * TEMPLATE_BYTES, t.bits.data()));
+                }
+                if (best < expected.confidence) expected = RecognitionResult(t.letter, t.rotation, best);
+            }
+            if (!same(recognizer.match_top_k<1>(query)[0], expected)) mismatches++;
+        }
+        if (mismatches == 0) {
+            std::cout << "✓ radius " << radius << ": " << count << " queries match brute force" << std::endl;
+        } else {
+            std::cout << "✗ radius " << radius << ": " << mismatches << "/" << count << " queries differ from brute force" << std::endl;
+            failures++;
+        }
+    }
+
+    // Off-centre glyphs: exact position only vs a +-2 window
+    RecognizerConfig window;
+    window.shift_radius = 2;
+    Recognizer exact(bank), tolerant(bank, window);
+    long exact_distance = 0, tolerant_distance = 0;
+    int exact_correct = 0, tolerant_correct = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* query = queries.data() + i * TEMPLATE_BYTES;
+        RecognitionResult a = exact.match_top_k<1>(query)[0];
+        RecognitionResult b = tolerant.match_top_k<1>(query)[0];
+        exact_distance += a.confidence;
+        tolerant_distance += b.confidence;
+        if (a.letter == bank[sources[i]].letter && a.rotation == bank[sources[i]].rotation) exact_correct++;
+        if (b.letter == bank[sources[i]].letter && b.rotation == bank[sources[i]].rotation) tolerant_correct++;
+    }
+    std::cout << "Off-centre queries, mean distance: " << exact_distance / double(count) << " (exact), "
+              << tolerant_distance / double(count) << " (+-2 px); correct: " << exact_correct << " vs "
+              << tolerant_correct << " of " << count << std::endl;
+    if (tolerant_correct == static_cast<int>(count) && tolerant_distance < exact_distance) {
+        std::cout << "✓ the shift window recovers every off-centre query" << std::endl;
+    } else {
+        std::cout << "✗ the shift window misses off-centre queries" << std::endl;
+        failures++;
+    }
+
+    // Coarse-to-fine and early exit keep working with a window
+    RecognizerConfig pruned = window;
+    pruned.coarse_to_fine_min_templates = 1;
+    pruned.early_exit_at_threshold = true;
+    pruned.threshold = 400;
+    Recognizer pruned_recognizer(bank, pruned);
+    int pruned_correct = 0;
+    for (size_t i = 0; i < count; i++) {
+        RecognitionResult r = pruned_recognizer.match(queries.data() + i * TEMPLATE_BYTES);
+        if (r.letter == bank[sources[i]].letter && r.rotation == bank[sources[i]].rotation) pruned_correct++;
+    }
+    if (pruned_correct == static_cast<int>(count)) {
+        std::cout << "✓ coarse-to-fine + early exit: " << pruned_correct << "/" << count << " correct" << std::endl;
+    } else {
+        std::cout << "✗ coarse-to-fine + early exit: " << pruned_correct << "/" << count << " correct" << std::endl;
+        failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include "thread_pool.h"
+#include <chrono>
+#include <iostream>
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+// (pool, index) of the worker running on this thread
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local int current_worker = -1;
+
+// CPUs this process may run on, in order (empty when unknown)
+static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    #if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    #endif
+    return cpus;
+}
+
+static void pin_current_thread(int cpu) {
+    #if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        std::cerr << "Warning: Could not pin worker thread to CPU " << cpu << std::endl;
+    }
+    #else
+    (void)cpu;
+    #endif
+}
+
+ThreadPool::ThreadPool(size_t threads, bool pin_threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    std::vector<int> cpus;
+    if (pin_threads) {
+        cpus = allowed_cpus();
+        if (cpus.empty()) std::cerr << "Warning: CPU affinity is not supported here; threads are not pinned" << std::endl;
+    }
+
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Start only once every deque exists, since workers steal from all of them
+    for (size_t i = 0; i < threads; i++) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        workers_[i]->thread = std::thread(&ThreadPool::worker_loop, this, i, cpu);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+int ThreadPool::worker_index() {
+    return current_worker;
+}
+
+bool ThreadPool::is_worker() const {
+    return current_pool == this;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Own deque when called from one of our workers, otherwise round-robin
+    size_t target = current_pool == this ? static_cast<size_t>(current_worker)
+                                         : next_queue_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    {
+        // Pairs with the predicate check in worker_loop so a wakeup is never lost
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::pop_task(size_t first, bool own_back, std::function<void()>& task) {
+    size_t n = workers_.size();
+    for (size_t k = 0; k < n; k++) {
+        Worker& worker = *workers_[(first + k) % n];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) continue;
+        if (k == 0 && own_back) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        queued_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::run_pending_task() {
+    std::function<void()> task;
+    bool found = current_pool == this
+        ? pop_task(static_cast<size_t>(current_worker), true, task)
+        : pop_task(next_queue_.fetch_add(1, std::memory_order_relaxed) % workers_.size(), false, task);
+    if (!found) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t index, int cpu) {
+    current_pool = this;
+    current_worker = static_cast<int>(index);
+    if (cpu >= 0) pin_current_thread(cpu);
+
+    std::function<void()> task;
+    while (true) {
+        if (pop_task(index, true, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+        if (stop_ && queued_.load() == 0) return;
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    // Tasks reference this group; never let it go away under them
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending_.fetch_add(1);
+    pool_.submit([this, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+        finish_one();
+    });
+}
+
+void TaskGroup::finish_one() {
+    // Under the lock: wait() takes it before returning, so the group cannot
+    // be destroyed while the last task is still in here
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.fetch_sub(1) == 1) done_.notify_all();
+}
+
+void TaskGroup::wait() {
+    if (!pool_.is_worker()) {
+        // Outside the pool the workers finish the group; the last
+        // finish_one() notifies under mutex_, so no wakeup is lost
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_.load() == 0; });
+    }
+    while (pending_.load() > 0) {
+        if (pool_.run_pending_task()) continue;
+        // Nothing queued: our tasks are running elsewhere. Sleep briefly and
+        // look again, since they may still queue more work we could help with.
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait_for(lock, std::chrono::microseconds(200), [this] { return pending_.load() == 0; });
+    }
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(error, error_);
+    }
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a task deque: it pushes and
+// pops its own work at the back (newest first, still warm in its cache)
+// and steals from the front of the others when it runs dry. Tasks
+// submitted from outside the pool are spread round-robin over the deques.
+class ThreadPool {
+public:
+    // threads = 0 uses every hardware thread. With pin_threads, worker i is
+    // bound to the i-th CPU the process may run on (Linux only; ignored
+    // elsewhere).
+    explicit ThreadPool(size_t threads = 0, bool pin_threads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Index of the calling worker in its pool, or -1 outside any pool
+    static int worker_index();
+    // True when called from one of this pool's workers
+    bool is_worker() const;
+
+    void submit(std::function<void()> task);
+    // Runs one queued task on the calling thread; false if none was found.
+    // Lets a thread that waits on its own tasks help instead of blocking.
+    bool run_pending_task();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    void worker_loop(size_t index, int cpu);
+    bool pop_task(size_t first, bool own_back, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<bool> stop_{false};
+};
+
+// A set of tasks on a pool that can be waited for. On a pool worker, wait()
+// runs queued tasks while it waits, so groups may be nested inside pool
+// tasks (an image task spawning its cell tasks) without tying up workers.
+// Any other thread just blocks until the group is done, so a caller never
+// ends up running unrelated work. The first exception thrown by a task is
+// rethrown from wait().
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    void finish_one();
+
+    ThreadPool& pool_;
+    std::atomic<size_t> pending_{0};
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::exception_ptr error_;
+};
+
+// Calls f(i) for every i in [begin, end) on the pool, grain indices per task
+template<class F>
+void parallel_for(ThreadPool& pool, size_t begin, size_t end, size_t grain, F f) {
+    if (grain == 0) grain = 1;
+    TaskGroup group(pool);
+    for (size_t chunk = begin; chunk < end; chunk += grain) {
+        size_t chunk_end = chunk + grain < end ? chunk + grain : end;
+        group.run([chunk, chunk_end, &f] {
+            for (size_t i = chunk; i < chunk_end; i++) f(i);
+        });
+    }
+    group.wait();
+}
@@ -0,0 +1,119 @@
+#include "parallel_recognition.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// Thread-scaling benchmark for the parallel recognition layer: the same
+// glyph set is recognized with 1, 2, 4, ... threads and the throughput,
+// speedup and parallel efficiency are printed per thread count.
+//
+// Without --templates a synthetic bank (26 letters x 4 rotations x
+// --variants) is used, and glyphs are synthetic in-memory images, so the
+// numbers measure preprocessing + matching without disk or decode.
+
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "  --templates PATH   template file (default: synthetic bank)" << std::endl;
+    std::cerr << "  --variants N       synthetic templates per letter and rotation (default: 25)" << std::endl;
+    std::cerr << "  --glyphs N         glyphs recognized per run (default: 2000)" << std::endl;
+    std::cerr << "  --max-threads N    largest thread count (default: all cores)" << std::endl;
+    std::cerr << "  --repeat N         runs per thread count, best one reported (default: 3)" << std::endl;
+    std::cerr << "  --pin              pin worker threads to CPUs" << std::endl;
+}
+
+static std::vector<Template> synthetic_templates(size_t variants, std::mt19937& rng) {
+    std::vector<Template> list;
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        for (int rotation = 0; rotation < 360; rotation += 90) {
+            for (size_t v = 0; v < variants; v++) {
+                Template t;
+                t.letter = letter;
+                t.rotation = rotation;
+                t.bits.resize(TEMPLATE_BYTES);
+                for (auto& byte : t.bits) byte = static_cast<uint8_t>(rng() & rng());
+                list.push_back(std::move(t));
+            }
+        }
+    }
+    return list;
+}
+
+// Dark rectangles of random size on a light background
+static std::vector<cv::Mat> synthetic_glyphs(size_t count, std::mt19937& rng) {
+    std::vector<cv::Mat> glyphs;
+    for (size_t i = 0; i < count; i++) {
+        cv::Mat glyph(80, 80, CV_8UC3, cv::Scalar(255, 255, 255));
+        int x0 = 10 + rng() % 20, y0 = 10 + rng() % 20;
+        int x1 = x0 + 10 + rng() % 30, y1 = y0 + 10 + rng() % 30;
+        for (int y = y0; y < y1; y++) {
+            uint8_t* row = glyph.ptr<uint8_t>(y);
+            for (int x = x0; x < x1; x++) {
+                row[x * 3] = row[x * 3 + 1] = row[x * 3 + 2] = 0;
+            }
+        }
+        glyphs.push_back(glyph);
+    }
+    return glyphs;
+}
+
+int main(int argc, char** argv) {
+    std::string templates_path;
+    size_t variants = 25, glyph_count = 2000, repeat = 3;
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool pin = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--templates" && has_value) templates_path = argv[++i];
+        else if (arg == "--variants" && has_value) variants = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--glyphs" && has_value) glyph_count = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--max-threads" && has_value) max_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--repeat" && has_value) repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--pin") pin = true;
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(12345);
+    Recognizer recognizer;
+    try {
+        recognizer = templates_path.empty() ? Recognizer(synthetic_templates(variants, rng))
+                                            : Recognizer::from_file(templates_path);
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading templates: " << e.what() << std::endl;
+        return 1;
+    }
+    std::vector<cv::Mat> glyphs = synthetic_glyphs(glyph_count, rng);
+
+    std::vector<size_t> thread_counts;
+    for (size_t t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "Templates: " << recognizer.bank().size() << ", glyphs per run: " << glyphs.size()
+              << ", kernel: " << active_hamming_kernel().name << (pin ? ", pinned" : "") << std::endl;
+    std::printf("%8s %12s %10s %11s\n", "threads", "glyphs/s", "speedup", "efficiency");
+
+    double baseline = 0;
+    for (size_t threads : thread_counts) {
+        ThreadPool pool(threads, pin);
+        recognize_glyphs_parallel(pool, recognizer, glyphs);  // Warm-up (scratch, caches)
+
+        double best = 0;
+        for (size_t r = 0; r < repeat; r++) {
+            auto start = std::chrono::steady_clock::now();
+            recognize_glyphs_parallel(pool, recognizer, glyphs);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::max(best, glyphs.size() / seconds);
+        }
+        if (threads == 1) baseline = best;
+        double speedup = baseline > 0 ? best / baseline : 0;
+        std::printf("%8zu %12.0f %9.2fx %10.0f%%\n", threads, best, speedup, 100.0 * speedup / threads);
+    }
+    return 0;
+}
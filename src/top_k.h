@@ -0,0 +1,31 @@
+#pragma once
+#include "letter_recognition.h"
+#include <array>
+#include <cstddef>
+
+// Fixed-capacity best-K list, kept sorted (best first) while distances are
+// produced, so ranking needs neither a second sweep nor an allocation.
+// Ties keep the template seen first, like the plain minimum search.
+template<size_t K>
+class TopK {
+public:
+    static_assert(K > 0, "TopK needs at least one slot");
+
+    // Distance a candidate has to beat to enter the list (INT_MAX until full)
+    int worst() const { return items_[K - 1].confidence; }
+    const RecognitionResult& best() const { return items_[0]; }
+    const std::array<RecognitionResult, K>& results() const { return items_; }
+
+    void push(char letter, int rotation, int distance) {
+        if (distance >= items_[K - 1].confidence) return;
+        size_t pos = K - 1;
+        while (pos > 0 && items_[pos - 1].confidence > distance) {
+            items_[pos] = items_[pos - 1];
+            pos--;
+        }
+        items_[pos] = RecognitionResult(letter, rotation, distance);
+    }
+
+private:
+    std::array<RecognitionResult, K> items_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+
+// Recognition tracing.
+//
+//   Off      - nothing but the pixel work and the matching
+//   Counters - relaxed atomic counters (see trace_counters())
+//   Text     - per-call diagnostics on stdout
+//   Images   - also dump debug_resized.jpg / debug_binary.jpg
+//
+// The level is chosen at runtime (set_trace_level() or the LR_TRACE
+// environment variable: off|counters|text|images). Hot paths are written
+// as templates over a TracePolicy, so the Off instantiation contains no
+// tracing code at all. Building with -DLR_TRACE_MAX_LEVEL=<0..3> removes
+// the higher levels from the binary entirely.
+
+#ifndef LR_TRACE_MAX_LEVEL
+#define LR_TRACE_MAX_LEVEL 3
+#endif
+
+enum class TraceLevel { Off = 0, Counters = 1, Text = 2, Images = 3 };
+
+template<TraceLevel L>
+struct TracePolicy {
+    static constexpr TraceLevel level = L;
+    static constexpr bool counters = L >= TraceLevel::Counters;
+    static constexpr bool text = L >= TraceLevel::Text;
+    static constexpr bool images = L >= TraceLevel::Images;
+};
+
+struct TraceCounters {
+    std::atomic<uint64_t> recognitions{0};
+    std::atomic<uint64_t> templates_compared{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> lower_bound_pruned{0};
+    std::atomic<uint64_t> early_exit_pruned{0};
+    std::atomic<uint64_t> coarse_pruned{0};
+    std::atomic<uint64_t> class_pruned{0};
+    std::atomic<uint64_t> classes_pruned{0};
+
+    void reset() {
+        recognitions = 0;
+        templates_compared = 0;
+        rejected = 0;
+        lower_bound_pruned = 0;
+        early_exit_pruned = 0;
+        coarse_pruned = 0;
+        class_pruned = 0;
+        classes_pruned = 0;
+    }
+};
+
+inline TraceCounters& trace_counters() {
+    static TraceCounters counters;
+    return counters;
+}
+
+inline void print_trace_counters(std::ostream& os) {
+    const TraceCounters& c = trace_counters();
+    os << "Trace counters:\n"
+       << "  recognitions: " << c.recognitions.load() << "\n"
+       << "  templates compared: " << c.templates_compared.load() << "\n"
+       << "  rejected (above threshold): " << c.rejected.load() << "\n"
+       << "  pruned by popcount bound: " << c.lower_bound_pruned.load() << "\n"
+       << "  pruned by early exit: " << c.early_exit_pruned.load() << "\n"
+       << "  pruned by coarse pyramid: " << c.coarse_pruned.load() << "\n"
+       << "  pruned by class prototype: " << c.class_pruned.load()
+       << " (" << c.classes_pruned.load() << " whole classes)\n";
+}
+
+inline TraceLevel parse_trace_level(const char* name, TraceLevel fallback) {
+    if (!name) return fallback;
+    if (std::strcmp(name, "off") == 0) return TraceLevel::Off;
+    if (std::strcmp(name, "counters") == 0) return TraceLevel::Counters;
+    if (std::strcmp(name, "text") == 0) return TraceLevel::Text;
+    if (std::strcmp(name, "images") == 0) return TraceLevel::Images;
+    return fallback;
+}
+
+namespace trace_detail {
+inline TraceLevel clamp(TraceLevel level) {
+    return static_cast<int>(level) > LR_TRACE_MAX_LEVEL
+        ? static_cast<TraceLevel>(LR_TRACE_MAX_LEVEL) : level;
+}
+
+inline std::atomic<int>& level_storage() {
+    static std::atomic<int> level{static_cast<int>(
+        clamp(parse_trace_level(std::getenv("LR_TRACE"), TraceLevel::Off)))};
+    return level;
+}
+}
+
+inline TraceLevel trace_level() {
+    return static_cast<TraceLevel>(trace_detail::level_storage().load(std::memory_order_relaxed));
+}
+
+inline void set_trace_level(TraceLevel level) {
+    trace_detail::level_storage().store(static_cast<int>(trace_detail::clamp(level)),
+                                        std::memory_order_relaxed);
+}
+
+// Calls f(TracePolicy<level>()) for the current runtime level
+template<class F>
+auto with_trace_policy(F&& f) {
+    switch (trace_level()) {
+    #if LR_TRACE_MAX_LEVEL >= 3
+    case TraceLevel::Images: return f(TracePolicy<TraceLevel::Images>());
+    #endif
+    #if LR_TRACE_MAX_LEVEL >= 2
+    case TraceLevel::Text: return f(TracePolicy<TraceLevel::Text>());
+    #endif
+    #if LR_TRACE_MAX_LEVEL >= 1
+    case TraceLevel::Counters: return f(TracePolicy<TraceLevel::Counters>());
+    #endif
+    default: return f(TracePolicy<TraceLevel::Off>());
+    }
+}